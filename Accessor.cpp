@@ -0,0 +1,171 @@
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <print>
+#include <span>
+#include <vector>
+
+#include "Accessor.h"
+
+namespace {
+
+template<typename T>
+T load(const unsigned char* p) {
+  T t;
+  std::memcpy(&t, p, sizeof(T));
+  return t;
+}
+
+float readComponent(const unsigned char* p, int componentType, bool normalized) {
+  // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#animations, normalized integers
+  switch(componentType) {
+  case TINYGLTF_COMPONENT_TYPE_FLOAT:          return load<float>(p);
+  case TINYGLTF_COMPONENT_TYPE_BYTE:           return normalized ? std::max(load<std::int8_t>(p) / 127.0f, -1.0f) : load<std::int8_t>(p);
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  return normalized ? load<std::uint8_t>(p) / 255.0f : load<std::uint8_t>(p);
+  case TINYGLTF_COMPONENT_TYPE_SHORT:          return normalized ? std::max(load<std::int16_t>(p) / 32767.0f, -1.0f) : load<std::int16_t>(p);
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return normalized ? load<std::uint16_t>(p) / 65535.0f : load<std::uint16_t>(p);
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:   return static_cast<float>(load<std::uint32_t>(p));
+  default:                                     return 0.0f;
+  }
+}
+
+template<typename T>
+void widen(const unsigned char* p, std::span<std::uint32_t> out) {
+  for(std::size_t i = 0; i < std::size(out); ++i)
+    out[i] = load<T>(p + i * sizeof(T));
+}
+
+// one fixed size copy per substitution, the common element sizes get their own loop
+template<std::size_t Size>
+void scatter(unsigned char* elements, std::span<const std::uint32_t> indices, const unsigned char* values) {
+  for(std::size_t i = 0; i < std::size(indices); ++i)
+    std::memcpy(elements + std::size_t(indices[i]) * Size, values + i * Size, Size);
+}
+
+void scatter(unsigned char* elements, std::span<const std::uint32_t> indices, const unsigned char* values, std::size_t elementSize) {
+  switch(elementSize) {
+  case 2:  scatter<2>(elements, indices, values); break;
+  case 4:  scatter<4>(elements, indices, values); break;
+  case 8:  scatter<8>(elements, indices, values); break;
+  case 12: scatter<12>(elements, indices, values); break;
+  case 16: scatter<16>(elements, indices, values); break;
+  case 64: scatter<64>(elements, indices, values); break;
+  default:
+    for(std::size_t i = 0; i < std::size(indices); ++i)
+      std::memcpy(elements + std::size_t(indices[i]) * elementSize, values + i * elementSize, elementSize);
+  }
+}
+
+// Sparse values are tightly packed, their indices strictly increasing
+void applySparse(const tn::Model& model, buffer_data_t buffers, const tn::Accessor& accessor, std::span<unsigned char> elements, std::size_t elementSize) {
+  const tn::Accessor::Sparse& sparse = accessor.sparse;
+
+  std::vector<std::uint32_t> indices(sparse.count);
+  const unsigned char* indexData = bufferViewData(model, buffers, sparse.indices.bufferView) + sparse.indices.byteOffset;
+
+  switch(sparse.indices.componentType) {
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  widen<std::uint8_t>(indexData, indices); break;
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: widen<std::uint16_t>(indexData, indices); break;
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:   widen<std::uint32_t>(indexData, indices); break;
+  default:                                     std::println("Error [Accessor] sparse index component type {} of accessor {}", sparse.indices.componentType, accessor.name); return;
+  }
+
+  if(!std::ranges::all_of(indices, [&](std::uint32_t i) { return i < accessor.count; })) {
+    std::println("Error [Accessor] sparse index out of range in accessor {}", accessor.name);
+    return;
+  }
+
+  scatter(std::data(elements), indices, bufferViewData(model, buffers, sparse.values.bufferView) + sparse.values.byteOffset, elementSize);
+}
+
+}
+
+const unsigned char* bufferViewData(const tn::Model& model, buffer_data_t buffers, int bufferViewIndex) {
+  const tn::BufferView& bv = model.bufferViews[bufferViewIndex];
+  return std::data(buffers[bv.buffer]) + bv.byteOffset;
+}
+
+std::vector<unsigned char> resolveAccessor(const tn::Model& model, buffer_data_t buffers, int accessorIndex) {
+  const tn::Accessor& accessor = model.accessors[accessorIndex];
+
+  const std::size_t elementSize = tn::GetNumComponentsInType(accessor.type) * tn::GetComponentSizeInBytes(accessor.componentType);
+  std::vector<unsigned char> elements(accessor.count * elementSize);
+
+  if(accessor.bufferView != -1) {
+    const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
+
+    const std::size_t stride = accessor.ByteStride(bv);
+    const unsigned char* base = bufferViewData(model, buffers, accessor.bufferView) + accessor.byteOffset;
+
+    if(stride == elementSize)
+      std::memcpy(std::data(elements), base, std::size(elements));
+    else
+      for(size_t i = 0; i < accessor.count; ++i)
+        std::memcpy(std::data(elements) + i * elementSize, base + i * stride, elementSize);
+  }
+
+  if(accessor.sparse.isSparse)
+    applySparse(model, buffers, accessor, elements, elementSize);
+
+  return elements;
+}
+
+void appendAccessor(const tn::Model& model, buffer_data_t buffers, int accessorIndex, std::vector<float>& out) {
+  const tn::Accessor& accessor = model.accessors[accessorIndex];
+
+  const int components = tn::GetNumComponentsInType(accessor.type);
+  out.reserve(std::size(out) + accessor.count * components);
+
+  if(accessor.bufferView == -1 && !accessor.sparse.isSparse) { // no data, all zeros
+    out.insert(std::end(out), accessor.count * components, 0.0f);
+    return;
+  }
+
+  const int componentSize = tn::GetComponentSizeInBytes(accessor.componentType);
+
+  // sparse ones are read from a resolved copy
+  std::vector<unsigned char> resolved;
+  int stride = components * componentSize;
+  const unsigned char* base;
+
+  if(accessor.sparse.isSparse) {
+    resolved = resolveAccessor(model, buffers, accessorIndex);
+    base = std::data(resolved);
+  } else {
+    stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+    base = bufferViewData(model, buffers, accessor.bufferView) + accessor.byteOffset;
+  }
+
+  for(size_t i = 0; i < accessor.count; ++i)
+    for(int c = 0; c < components; ++c)
+      out.push_back(readComponent(base + i * stride + c * componentSize, accessor.componentType, accessor.normalized));
+}
+
+void appendIndices(const tn::Model& model, buffer_data_t buffers, int accessorIndex, std::vector<std::uint32_t>& out) {
+  const tn::Accessor& accessor = model.accessors[accessorIndex];
+
+  std::vector<unsigned char> resolved;
+  int stride = tn::GetComponentSizeInBytes(accessor.componentType);
+  const unsigned char* base;
+
+  if(accessor.sparse.isSparse || accessor.bufferView == -1) {
+    resolved = resolveAccessor(model, buffers, accessorIndex);
+    base = std::data(resolved);
+  } else {
+    stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+    base = bufferViewData(model, buffers, accessor.bufferView) + accessor.byteOffset;
+  }
+
+  out.reserve(std::size(out) + accessor.count);
+
+  for(size_t i = 0; i < accessor.count; ++i) {
+    switch(accessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  out.push_back(load<std::uint8_t>(base + i * stride)); break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: out.push_back(load<std::uint16_t>(base + i * stride)); break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:   out.push_back(load<std::uint32_t>(base + i * stride)); break;
+    }
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tinygltf {
+class Model;
+}
+
+namespace tn = tinygltf;
+
+// Bytes of each glTF buffer, either tn::Buffer::data or a range of a mapped file
+using buffer_data_t = std::span<const std::span<const unsigned char>>;
+
+// Start of a buffer view's bytes
+const unsigned char* bufferViewData(const tn::Model& model, buffer_data_t buffers, int bufferViewIndex);
+
+// The accessor's elements tightly packed in their component type, zeros without a buffer view, with the sparse substitutions applied
+std::vector<unsigned char> resolveAccessor(const tn::Model& model, buffer_data_t buffers, int accessorIndex);
+
+// Appends accessor elements as tightly packed floats, honouring byte stride, sparse substitutions and normalized integer components
+void appendAccessor(const tn::Model& model, buffer_data_t buffers, int accessorIndex, std::vector<float>& out);
+
+// Appends index accessor elements widened to 32 bit, sparse ones resolved
+void appendIndices(const tn::Model& model, buffer_data_t buffers, int accessorIndex, std::vector<std::uint32_t>& out);
@@ -0,0 +1,137 @@
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Animation.h"
+#include "Accessor.h"
+
+std::vector<animation_clip_t> compileAnimations(const tn::Model& model, buffer_data_t buffers) {
+  std::vector<animation_clip_t> clips;
+  clips.reserve(std::size(model.animations));
+
+  for(const tn::Animation& animation : model.animations) {
+    animation_clip_t clip;
+    clip.name = animation.name;
+
+    for(const tn::AnimationSampler& s : animation.samplers) {
+      animation_sampler_t sampler;
+
+      if(s.interpolation == "STEP")
+        sampler.interpolation = interpolation_t::step;
+      else if(s.interpolation == "CUBICSPLINE")
+        sampler.interpolation = interpolation_t::cubicSpline;
+      else
+        sampler.interpolation = interpolation_t::linear;
+
+      sampler.firstKey = std::size(clip.timestamps);
+      appendAccessor(model, buffers, s.input, clip.timestamps);
+      sampler.keyCount = std::size(clip.timestamps) - sampler.firstKey;
+
+      sampler.firstValue = std::size(clip.values);
+      appendAccessor(model, buffers, s.output, clip.values);
+      const std::uint32_t valueCount = std::size(clip.values) - sampler.firstValue;
+
+      const std::uint32_t elementsPerKey = sampler.interpolation == interpolation_t::cubicSpline ? 3 : 1;
+      sampler.components = sampler.keyCount != 0 ? valueCount / (sampler.keyCount * elementsPerKey) : 0;
+
+      if(sampler.keyCount != 0)
+        clip.duration = std::max(clip.duration, clip.timestamps.back());
+
+      clip.samplers.push_back(sampler);
+    }
+
+    for(const tn::AnimationChannel& c : animation.channels) {
+      if(c.target_node == -1)
+        continue;
+
+      animation_channel_t channel;
+      channel.sampler = c.sampler;
+      channel.targetNode = c.target_node;
+
+      if(c.target_path == "translation")
+        channel.path = animation_path_t::translation;
+      else if(c.target_path == "rotation")
+        channel.path = animation_path_t::rotation;
+      else if(c.target_path == "scale")
+        channel.path = animation_path_t::scale;
+      else if(c.target_path == "weights")
+        channel.path = animation_path_t::weights;
+      else
+        continue;
+
+      clip.channels.push_back(channel);
+    }
+
+    clips.push_back(std::move(clip));
+  }
+
+  return clips;
+}
+
+void sampleChannel(const animation_clip_t& clip, animation_channel_t& channel, float time, float* out) {
+  const animation_sampler_t& sampler = clip.samplers[channel.sampler];
+  if(sampler.keyCount == 0)
+    return;
+
+  const float* timestamps = std::data(clip.timestamps) + sampler.firstKey;
+  const float* values = std::data(clip.values) + sampler.firstValue;
+
+  const std::uint32_t n = sampler.components;
+  const std::uint32_t last = sampler.keyCount - 1;
+
+  std::uint32_t& cursor = channel.cursor;
+  if(cursor > last || timestamps[cursor] > time) // clip looped
+    cursor = 0;
+
+  while(cursor < last && timestamps[cursor + 1] <= time)
+    ++cursor;
+
+  const std::uint32_t prev = cursor;
+  const std::uint32_t next = std::min(cursor + 1, last);
+
+  const float previousTime = timestamps[prev];
+  const float nextTime = timestamps[next];
+
+  const float td = nextTime - previousTime;
+  const float interpolant = td > 0.0f ? std::clamp((time - previousTime) / td, 0.0f, 1.0f) : 0.0f;
+
+  switch(sampler.interpolation) {
+  case interpolation_t::step: std::copy_n(values + prev * n, n, out); break;
+
+  case interpolation_t::linear:
+    if(channel.path == animation_path_t::rotation) {
+      const glm::quat currentRotation = glm::slerp(glm::make_quat(values + prev * n), glm::make_quat(values + next * n), interpolant);
+      std::copy_n(glm::value_ptr(currentRotation), 4, out);
+    } else {
+      for(std::uint32_t i = 0; i < n; ++i)
+        out[i] = values[prev * n + i] + interpolant * (values[next * n + i] - values[prev * n + i]);
+    }
+    break;
+
+  case interpolation_t::cubicSpline: {
+    const float* v_prev = values + (prev * 3 + 1) * n;
+    const float* b_prev = values + (prev * 3 + 2) * n;
+
+    const float* a_next = values + (next * 3 + 0) * n;
+    const float* v_next = values + (next * 3 + 1) * n;
+
+    const float t = interpolant;
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+
+    // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#interpolation-cubic
+    for(std::uint32_t i = 0; i < n; ++i)
+      out[i] = (2.0f * t3 - 3.0f * t2 + 1.0f) * v_prev[i] + td * (t3 - 2.0f * t2 + t) * b_prev[i] + (-2.0f * t3 + 3.0f * t2) * v_next[i] + td * (t3 - t2) * a_next[i];
+
+    if(channel.path == animation_path_t::rotation) {
+      const glm::quat currentRotation = glm::normalize(glm::make_quat(out));
+      std::copy_n(glm::value_ptr(currentRotation), 4, out);
+    }
+  } break;
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Accessor.h"
+
+enum class animation_path_t : std::uint8_t { translation, rotation, scale, weights };
+
+enum class interpolation_t : std::uint8_t { step, linear, cubicSpline };
+
+struct animation_sampler_t {
+  interpolation_t interpolation = interpolation_t::linear; // default
+
+  std::uint32_t firstKey;   // into animation_clip_t::timestamps
+  std::uint32_t keyCount;
+  std::uint32_t firstValue; // into animation_clip_t::values
+  std::uint32_t components; // floats per output element, 3 for translation, 4 for rotation ...
+};
+
+struct animation_channel_t {
+  std::uint32_t sampler;
+  int targetNode;
+  animation_path_t path;
+
+  std::uint32_t cursor = 0; // keyframe found by the last lookup, time is expected to move forward
+};
+
+// glTF animation resolved at load time, keyframe data of all samplers are packed into two contiguous arrays
+struct animation_clip_t {
+  std::string name;
+  float duration = 0.0f;
+
+  std::vector<float> timestamps;
+  std::vector<float> values; // cubic spline outputs keep glTF layout: in-tangent, value, out-tangent
+
+  std::vector<animation_sampler_t> samplers;
+  std::vector<animation_channel_t> channels;
+};
+
+std::vector<animation_clip_t> compileAnimations(const tn::Model& model, buffer_data_t buffers);
+
+// Writes sampler.components floats to out
+void sampleChannel(const animation_clip_t& clip, animation_channel_t& channel, float time, float* out);
@@ -1,5 +1,6 @@
 #include "App.h"
 
+#include <glm/geometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 
@@ -12,6 +13,12 @@
 
 #include <imfilebrowser.h>
 
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <format>
+#include <string>
 #include <vector>
 #include <utility>
 #include <print>
@@ -25,43 +32,23 @@ void App::setConfigDefaults() {
 
 void App::startup() {
 
-  programID = shaderLoader
-                  .load({"shaders/vertexShader.vert", "shaders/fragmentShader.frag"}) //
-                  .compile()
-                  .attach()
-                  .link()
-                  .getProgramID();
+#ifdef NDEBUG
+  const std::vector<std::string> shaderDefines;
+#else
+  const std::vector<std::string> shaderDefines = {"SHADER_DEBUG"}; // unoptimized, debuggable shaders
+#endif
 
-  my_scene.setProgramID(programID);
+  programs.setCacheDirectory("shaderCache")
+      .setSources({"shaders/vertexShader.vert", "shaders/fragmentShader.frag"}, material_t::textureDefines, shaderDefines);
 
-  viewMatrixLocation = glGetUniformLocation(programID, "view");
-  projectionMatrixLocation = glGetUniformLocation(programID, "projection");
-  transformMatrixLocation = glGetUniformLocation(programID, "transform");
+  my_scene.setThreadPool(&threadPool);
 
-  pbr.baseColorLocation = glGetUniformLocation(programID, "pbr.baseColor");
-  pbr.roughnessLocation = glGetUniformLocation(programID, "pbr.roughness");
-  pbr.metallicLocation = glGetUniformLocation(programID, "pbr.metallic");
-
-  pbr.baseColorTextureLocation.isDefined = glGetUniformLocation(programID, "baseColorTexture.isDefined");
-  pbr.baseColorTextureLocation.sampler = glGetUniformLocation(programID, "baseColorTexture.sampler");
-
-  pbr.metallicRoughnessTextureLocation.isDefined = glGetUniformLocation(programID, "metallicRoughnessTexture.isDefined");
-  pbr.metallicRoughnessTextureLocation.sampler = glGetUniformLocation(programID, "metallicRoughnessTexture.sampler");
-
-  normalTextureLocation.isDefined = glGetUniformLocation(programID, "normalTexture.isDefined");
-  normalTextureLocation.sampler = glGetUniformLocation(programID, "normalTexture.sampler");
-  normalTextureLocation.scale = glGetUniformLocation(programID, "normalTexture.scale");
-
-  occlusionTextureLocation.isDefined = glGetUniformLocation(programID, "occlusionTexture.isDefined");
-  occlusionTextureLocation.sampler = glGetUniformLocation(programID, "occlusionTexture.sampler");
-  occlusionTextureLocation.strength = glGetUniformLocation(programID, "occlusionTexture.strength");
-
-  emissiveFactorLocation = glGetUniformLocation(programID, "emissiveFactor");
-  emissiveTextureLocation.isDefined = glGetUniformLocation(programID, "emissiveTexture.isDefined");
-  emissiveTextureLocation.sampler = glGetUniformLocation(programID, "emissiveTexture.sampler");
+  glCreateBuffers(1, &drawDataBufferID);
+  glCreateBuffers(1, &drawCommandBufferID);
 
   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
   glDisable(GL_CULL_FACE);
+  glCullFace(GL_BACK);
   glEnable(GL_DEPTH_TEST);
 
   p_fileDialog = new ImGui::FileBrowser{ImGuiFileBrowserFlags_CloseOnEsc | ImGuiFileBrowserFlags_ConfirmOnEnter};
@@ -81,7 +68,6 @@ void App::startup() {
   defaultView = glm::lookAt(eye, center, Y_up); // +z
 
   T t;
-  t.view = &defaultView;
   t.perspective = defaultCamera.projectionMatrix();
 
   this->active_camera = "Default";
@@ -110,6 +96,8 @@ void App::render(double currentTime) {
 
   static ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
+  profiler.beginFrame();
+
   // Start the Dear ImGui frame
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
@@ -133,17 +121,57 @@ void App::render(double currentTime) {
     ImGui::EndCombo();
   }
 
+  if(bool parallelAnimation = my_scene.animationMode == Scene::animation_mode_t::parallel; ImGui::Checkbox("Parallel animation", &parallelAnimation))
+    my_scene.animationMode = parallelAnimation ? Scene::animation_mode_t::parallel : Scene::animation_mode_t::serial;
+
+  if(bool mergedGeometry = my_scene.geometryMode == Scene::geometry_mode_t::merged; ImGui::Checkbox("Merged geometry (next load)", &mergedGeometry))
+    my_scene.geometryMode = mergedGeometry ? Scene::geometry_mode_t::merged : Scene::geometry_mode_t::separate;
+
+  ImGui::Checkbox("Load in background", &background_loading);
+  ImGui::Checkbox("Scene cache", &my_scene.useSceneCache);
+  ImGui::Checkbox("Optimize meshes (next load)", &my_scene.optimizeMeshes);
+  ImGui::Checkbox("Quantize vertices (next load)", &my_scene.quantizeVertices);
+
+  if(int cullMode = std::to_underlying(cull_mode); ImGui::Combo("Frustum culling", &cullMode, "None\0Flat\0Hierarchy\0"))
+    cull_mode = static_cast<cull_mode_t>(cullMode);
+  ImGui::Text("Culled draws: %zu / %zu", culledDraws, totalDraws);
+
+  ImGui::Checkbox("LOD", &lod_selection);
+  ImGui::SliderFloat("LOD error (pixels)", &lod_threshold, 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+  ImGui::Text("Triangles: %zu", drawnTriangles);
+  ImGui::Text("Draw calls: %zu for %zu instances", std::size(drawBatches), std::size(drawData));
+  ImGui::Text("Joints: %zu in %zu skins", my_scene.jointPalette.size(), std::size(my_scene.skins));
+  ImGui::Text("Morph weights: %zu / %zu active", std::size(my_scene.activeMorphWeights), std::size(my_scene.morphWeights));
+
+  putLoadProgress();
+
   ImGui::End();
 
+  if(profiler_window_visible)
+    putProfiler();
+
   p_fileDialog->Display();
 
   if(p_fileDialog->HasSelected()) {
     std::println("-- Selected filename {}", p_fileDialog->GetSelected().string());
-    is_scene_loaded = my_scene.load(p_fileDialog->GetSelected());
-    this->loadSceneCameras();
+
+    if(background_loading) {
+      my_scene.loadAsync(p_fileDialog->GetSelected());
+    } else {
+      const util::Profiler::cpu_scope_t scope(profiler, "load");
+      is_scene_loaded = my_scene.load(p_fileDialog->GetSelected());
+      this->loadSceneCameras();
+    }
+
     p_fileDialog->ClearSelected();
   }
 
+  if(const Scene::load_stage_t stage = my_scene.loadStage(); stage == Scene::load_stage_t::parsed || stage == Scene::load_stage_t::failed) {
+    const util::Profiler::cpu_scope_t scope(profiler, "load"); // the GL uploads, parsing ran on the loader thread
+    is_scene_loaded = my_scene.finishLoad();
+    this->loadSceneCameras();
+  }
+
   if(imgui_demo_window_visible) {
     ImGui::ShowDemoWindow(&imgui_demo_window_visible);
   }
@@ -155,83 +183,266 @@ void App::render(double currentTime) {
   glClearBufferfv(GL_COLOR, 0, black);
 
   if(is_scene_loaded) {
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(cameras[active_camera].perspective));
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(*cameras[active_camera].view));
+    const T& camera = cameras[active_camera];
+    const glm::mat4x4 view = camera.node == -1 ? defaultView : my_scene.viewMatrix(camera.node);
+
+    buildRenderQueue(view, camera.perspective);
+    submitRenderQueue(view, camera.perspective);
+
+    const util::Profiler::cpu_scope_t scope(profiler, "animate");
+    my_scene.animate(currentTime);
+  }
 
-    for(const auto& [_, node_buffer] : my_scene.getBuffers()) {
-      if(node_buffer.type != node_t::type_t::mesh)
-        continue;
+  {
+    const util::Profiler::gpu_scope_t scope(profiler, "imgui");
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  }
 
-      glUniformMatrix4fv(transformMatrixLocation, 1, GL_FALSE, glm::value_ptr(node_buffer.transformMatrix()));
+  profiler.endFrame();
+}
 
-      glBindVertexArray(node_buffer.mesh_buffer.vertexArrayID);
+void App::buildRenderQueue(const glm::mat4x4& view, const glm::mat4x4& projection) {
+  const util::Profiler::cpu_scope_t scope(profiler, "cull");
 
-      if(node_buffer.mesh_buffer.material.doubleSided) {
-        glDisable(GL_CULL_FACE);
-      } else {
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-      }
+  renderQueue.clear();
 
-      glUniform4fv(pbr.baseColorLocation, 1, glm::value_ptr(node_buffer.mesh_buffer.material.pbr.baseColorFactor));
-      glUniform1f(pbr.roughnessLocation, node_buffer.mesh_buffer.material.pbr.roughnessFactor);
-      glUniform1f(pbr.metallicLocation, node_buffer.mesh_buffer.material.pbr.metallicFactor);
+  std::vector<node_t>& nodes = my_scene.getBuffers();
+  const std::vector<material_t>& materials = my_scene.getMaterials();
 
-      glUniform3fv(emissiveFactorLocation, 1, glm::value_ptr(node_buffer.mesh_buffer.material.emissiveFactor));
+  int viewportWidth = 0, viewportHeight = 0;
+  glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
 
-      if(node_buffer.mesh_buffer.material.pbr.baseColorTexture.textureID != -1) {
-        glUniform1i(pbr.baseColorTextureLocation.isDefined, true);
-        glBindTextureUnit(pbr.baseColorTextureLocation.sampler, node_buffer.mesh_buffer.material.pbr.baseColorTexture.textureID);
-      } else {
-        glUniform1i(pbr.baseColorTextureLocation.isDefined, false);
-      }
+  const auto pushNode = [&](int slot) {
+    if(nodes[slot].type != node_t::type_t::mesh)
+      return;
 
-      if(node_buffer.mesh_buffer.material.pbr.metallicRoughnessTexture.textureID != -1) {
-        glUniform1i(pbr.metallicRoughnessTextureLocation.isDefined, true);
-        glBindTextureUnit(pbr.metallicRoughnessTextureLocation.sampler, node_buffer.mesh_buffer.material.pbr.metallicRoughnessTexture.textureID);
-      } else {
-        glUniform1i(pbr.metallicRoughnessTextureLocation.isDefined, false);
-      }
+    const glm::mat4x4& world = my_scene.worldMatrix(slot);
+    const float depth = -(view * world[3]).z;
 
-      if(node_buffer.mesh_buffer.material.normalTexture.textureID != -1) {
-        glUniform1i(normalTextureLocation.isDefined, true);
-        glBindTextureUnit(normalTextureLocation.sampler, node_buffer.mesh_buffer.material.normalTexture.textureID);
-        glUniform1f(normalTextureLocation.scale, node_buffer.mesh_buffer.material.normalTexture.scale);
-      } else {
-        glUniform1i(normalTextureLocation.isDefined, false);
-      }
+    // pixels one mesh space unit covers at the node's distance, the largest world scale axis decides
+    const float worldScale = std::sqrt(std::max({glm::dot(glm::vec3(world[0]), glm::vec3(world[0])), glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                                                 glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))}));
+    const float pixelsPerUnit = worldScale * projection[1][1] * 0.5f * viewportHeight / std::max(depth, 1e-4f);
+
+    const mesh_buffer_t& mesh = my_scene.meshes[nodes[slot].mesh];
 
-      if(node_buffer.mesh_buffer.material.occlusionTexture.textureID != -1) {
-        glUniform1i(occlusionTextureLocation.isDefined, true);
-        glBindTextureUnit(occlusionTextureLocation.sampler, node_buffer.mesh_buffer.material.occlusionTexture.textureID);
-        glUniform1f(occlusionTextureLocation.strength, node_buffer.mesh_buffer.material.occlusionTexture.strength);
-      } else {
-        glUniform1i(occlusionTextureLocation.isDefined, false);
+    for(int i = 0; i < std::ssize(mesh.primitives); ++i) {
+      const primitive_buffer_t& primitive = mesh.primitives[i];
+      const material_t& material = materials[primitive.materialIndex];
+
+      if(int& lod = nodes[slot].lods[i]; !std::empty(primitive.lods))
+        lod = lod_selection ? selectLod(primitive.lods, lod, pixelsPerUnit, lod_threshold) : 0;
+
+      renderQueue.push(makeDrawKey(material.factors.textureFlags, !material.doubleSided, material.textureSet, primitive.vertexArrayID, primitive.materialIndex, depth), slot, i);
+    }
+  };
+
+  if(cull_mode == cull_mode_t::hierarchy) { // only the visible part of the tree is walked, nodes without bounds have nothing to draw
+    visibleSlots.clear();
+    my_scene.bvh.queryFrustum(extractFrustum(projection * view), visibleSlots);
+
+    for(int slot : visibleSlots)
+      pushNode(slot);
+  } else {
+    visibleNodes.resize(std::size(nodes));
+    if(cull_mode == cull_mode_t::flat)
+      cullBounds(extractFrustum(projection * view), my_scene.worldBounds, visibleNodes);
+
+    for(int slot = 0; slot < std::ssize(nodes); ++slot)
+      if(cull_mode == cull_mode_t::none || visibleNodes[slot] || my_scene.localBounds[slot].empty())
+        pushNode(slot);
+  }
+
+  totalDraws = my_scene.primitiveCount();
+  culledDraws = totalDraws - std::size(renderQueue.items());
+
+  renderQueue.sort();
+}
+
+void App::submitRenderQueue(const glm::mat4x4& view, const glm::mat4x4& projection) {
+  const util::Profiler::gpu_scope_t scope(profiler, "submit");
+
+  const std::vector<node_t>& nodes = my_scene.getBuffers();
+  const std::vector<mesh_buffer_t>& meshes = my_scene.meshes;
+  const std::vector<material_t>& materials = my_scene.getMaterials();
+
+  drawBatches.clear();
+  drawGroups.clear();
+  drawData.clear();
+  drawCommands.clear();
+  instanceGroups.clear();
+  instanceData.clear();
+  batchGroups.clear();
+  drawnTriangles = 0;
+
+  const draw_item_t* previous = nullptr;
+
+  for(const draw_item_t& item : renderQueue.items()) {
+    const node_t& node = nodes[item.node];
+    const primitive_buffer_t& primitive = meshes[node.mesh].primitives[item.primitive];
+    const material_t& material = materials[primitive.materialIndex];
+    const arena_range_t& range = primitive.arenaRange;
+
+    // the selected level's index range, the whole primitive without a LOD chain
+    const int lod = node.lods[item.primitive];
+    lod_range_t level{0, static_cast<std::uint32_t>(primitive.element.elementBufferID != -1 ? primitive.element.count : primitive.count), 0.0f};
+    if(!std::empty(primitive.lods))
+      level = primitive.lods[lod];
+    else if(range.arena != -1)
+      level = {range.firstIndex, range.indexCount, 0.0f};
+
+    const node_t* previousNode = previous != nullptr ? &nodes[previous->node] : nullptr;
+    const primitive_buffer_t* previousPrimitive = previous != nullptr ? &meshes[previousNode->mesh].primitives[previous->primitive] : nullptr;
+
+    // consecutive arena draws with the same state are submitted with one glMultiDrawElementsIndirect, materials are per draw
+    const bool batched = range.arena != -1 && previousPrimitive != nullptr && previousPrimitive->arenaRange.arena == range.arena &&
+                         materials[previousPrimitive->materialIndex].doubleSided == material.doubleSided &&
+                         materials[previousPrimitive->materialIndex].textureSet == material.textureSet;
+
+    // nodes sharing a mesh draw it as instances of one draw, per level
+    const std::uint64_t groupKey = std::uint64_t(node.mesh) << 32 | std::uint64_t(item.primitive) << 8 | lod;
+
+    if(batched) {
+      if(const auto [it, inserted] = batchGroups.try_emplace(groupKey, static_cast<std::uint32_t>(std::size(drawGroups))); inserted) {
+        drawGroups.push_back({&item, level, 0, 0});
+        ++drawBatches.back().groupCount;
       }
+    } else if(range.arena == -1 && previousPrimitive == &primitive && nodes[previous->node].lods[item.primitive] == lod) {
+      // the queue keeps a primitive's draws together, its vertex array is its own
+    } else {
+      batchGroups.clear();
+      batchGroups.emplace(groupKey, static_cast<std::uint32_t>(std::size(drawGroups)));
+      drawBatches.push_back({static_cast<std::uint32_t>(std::size(drawGroups)), 1});
+      drawGroups.push_back({&item, level, 0, 0});
+    }
+
+    const std::uint32_t group = range.arena != -1 ? batchGroups.at(groupKey) : static_cast<std::uint32_t>(std::size(drawGroups)) - 1;
+
+    const glm::mat4x4& world = my_scene.worldMatrix(item.node);
+    const bool quantized = primitive.vertexFormat & quantizedStreams;
+    const glm::mat4x4 transform = quantized ? world * primitive.quantization.matrix() : world;
+    const std::uint32_t firstJoint = node.skin != -1 ? my_scene.skins[node.skin].firstJoint : noSkin; // the joints replace the transform
 
-      if(node_buffer.mesh_buffer.material.emissiveTexture.textureID != -1) {
-        glUniform1i(emissiveTextureLocation.isDefined, true);
-        glBindTexture(emissiveTextureLocation.sampler, node_buffer.mesh_buffer.material.emissiveTexture.textureID);
-      } else {
-        glUniform1i(emissiveTextureLocation.isDefined, false);
+    draw_data_t data{transform, static_cast<std::uint32_t>(primitive.materialIndex), primitive.vertexFormat, firstJoint};
+    if(const morph_targets_t& morph = primitive.morphTargets; morph.targetCount != 0) {
+      data.firstMorphWeight = node.morph.firstActive;
+      data.morphWeightCount = node.morph.activeCount;
+      data.firstMorphDelta = morph.firstDelta;
+      data.morphVertexCount = morph.vertexCount;
+      data.morphAttributes = morph.attributes;
+    }
+
+    if(std::empty(node.instances)) {
+      instanceGroups.push_back(group);
+      instanceData.push_back(data);
+    } else {
+      for(const glm::mat4x4& instance : node.instances) { // EXT_mesh_gpu_instancing, the instance transform goes between the node and the mesh
+        data.transform = quantized ? world * instance * primitive.quantization.matrix() : world * instance;
+        instanceGroups.push_back(group);
+        instanceData.push_back(data);
       }
+    }
+
+    drawGroups[group].instanceCount += std::empty(node.instances) ? 1 : std::size(node.instances);
+    previous = &item;
+  }
+
+  // instances of a group have to be consecutive for gl_BaseInstance + gl_InstanceID, counting sort them by group
+  for(std::uint32_t firstInstance = 0; draw_group_t& group : drawGroups) {
+    group.firstInstance = firstInstance;
+    firstInstance += group.instanceCount;
+    group.instanceCount = 0;
+  }
+
+  drawData.resize(std::size(instanceData));
+  for(std::size_t i = 0; i < std::size(instanceData); ++i) {
+    draw_group_t& group = drawGroups[instanceGroups[i]];
+    drawData[group.firstInstance + group.instanceCount++] = instanceData[i];
+  }
+
+  for(const draw_group_t& group : drawGroups) { // one command per group, only arena batches read them
+    const primitive_buffer_t& primitive = meshes[nodes[group.item->node].mesh].primitives[group.item->primitive];
+    drawCommands.push_back({group.level.indexCount, group.instanceCount, group.level.firstIndex, primitive.arenaRange.baseVertex, group.firstInstance});
+    drawnTriangles += group.level.indexCount / 3 * group.instanceCount;
+  }
 
-      if(node_buffer.mesh_buffer.element.elementBufferID != -1)
-        glDrawElements(node_buffer.mesh_buffer.element.mode, node_buffer.mesh_buffer.element.count, node_buffer.mesh_buffer.element.componentType, nullptr);
+  glNamedBufferData(drawDataBufferID, std::size(drawData) * sizeof(draw_data_t), std::data(drawData), GL_STREAM_DRAW);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawDataBufferID);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, my_scene.materialBufferID);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, my_scene.jointPaletteBufferID);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, my_scene.morphDeltaBufferID);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, my_scene.morphWeightBufferID);
+
+  glNamedBufferData(drawCommandBufferID, std::size(drawCommands) * sizeof(draw_elements_indirect_command_t), std::data(drawCommands), GL_STREAM_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBufferID);
+
+  struct {
+    std::uint32_t program = -1; // feature mask of the program variant
+    GLuint vertexArray = 0;
+    int cullFace = -1;
+    std::uint32_t textureSet = -1;
+  } bound; // GL state set by the previous batch
+
+  for(const draw_batch_t& batch : drawBatches) {
+    const draw_group_t& group = drawGroups[batch.firstGroup];
+    const primitive_buffer_t& primitive = meshes[nodes[group.item->node].mesh].primitives[group.item->primitive];
+    const material_t& material = materials[primitive.materialIndex];
+
+    if(bound.program != material.factors.textureFlags) { // compiled on first use
+      glUseProgram(programs.get(material.factors.textureFlags));
+      glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
+      glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projection));
+      bound.program = material.factors.textureFlags;
+    }
+
+    if(bound.vertexArray != primitive.vertexArrayID) {
+      glBindVertexArray(primitive.vertexArrayID);
+      bound.vertexArray = primitive.vertexArrayID;
+    }
+
+    if(const int cullFace = !material.doubleSided; bound.cullFace != cullFace) {
+      if(cullFace)
+        glEnable(GL_CULL_FACE);
       else
-        glDrawArrays(node_buffer.mesh_buffer.element.mode, 0, node_buffer.mesh_buffer.count);
+        glDisable(GL_CULL_FACE);
+      bound.cullFace = cullFace;
     }
 
-    my_scene.animate(currentTime);
-  }
+    if(bound.textureSet != material.textureSet) { // texture unit n holds textureKind n, the program variant only samples the present ones
+      for(GLuint unit = 0; unit < std::size(material.textures); ++unit) {
+        if(material.textures[unit] != 0) {
+          glBindTextureUnit(unit, material.textures[unit]);
+          glBindSampler(unit, material.samplers[unit]);
+        }
+      }
+      bound.textureSet = material.textureSet;
+    }
 
-  ImGui::Render();
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if(primitive.arenaRange.arena != -1)
+      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(batch.firstGroup * sizeof(draw_elements_indirect_command_t)), batch.groupCount, 0);
+    else if(!std::empty(primitive.lods)) // every level in one element buffer
+      glDrawElementsInstancedBaseInstance(primitive.element.mode, group.level.indexCount, primitive.element.componentType,
+                                          reinterpret_cast<const void*>(group.level.firstIndex * tn::GetComponentSizeInBytes(primitive.element.componentType)),
+                                          group.instanceCount, group.firstInstance);
+    else if(primitive.element.elementBufferID != -1)
+      glDrawElementsInstancedBaseInstance(primitive.element.mode, primitive.element.count, primitive.element.componentType, reinterpret_cast<const void*>(primitive.element.offset),
+                                          group.instanceCount, group.firstInstance);
+    else
+      glDrawArraysInstancedBaseInstance(primitive.element.mode, 0, primitive.count, group.instanceCount, group.firstInstance);
+  }
 }
 
 void App::shutdown() {
+  my_scene.cancelLoad();
   my_scene.unload();
-  shaderLoader.unload();
+
+  glDeleteBuffers(1, &drawDataBufferID);
+  glDeleteBuffers(1, &drawCommandBufferID);
+
+  profiler.unload();
+
+  programs.unload();
 
   delete p_fileDialog;
 
@@ -246,19 +457,18 @@ void App::shutdown() {
 void App::putMenuBar() {
   if(ImGui::BeginMenu("File")) {
     if(ImGui::MenuItem("Open scene")) {
-      if(is_scene_loaded) { // if it's already open, close first
-        is_scene_loaded = false;
-        my_scene.unload();
+      if(is_scene_loaded || my_scene.loadStage() != Scene::load_stage_t::idle) { // if it's already open or loading, close first
+        closeScene();
       }
       p_fileDialog->Open();
     }
 
     if(ImGui::MenuItem("Close scene")) {
-      is_scene_loaded = false;
-      my_scene.unload();
+      closeScene();
     }
 
     ImGui::MenuItem("Dear ImGui demo", nullptr, &imgui_demo_window_visible);
+    ImGui::MenuItem("Profiler", nullptr, &profiler_window_visible);
 
     if(ImGui::MenuItem("Close")) {
       running = false;
@@ -271,16 +481,94 @@ void App::putMenuBar() {
 }
 
 void App::loadSceneCameras() {
-  for(auto& [id, node] : my_scene.getBuffers()) {
+  for(int slot = 0; const node_t& node : my_scene.getBuffers()) {
     if(node.camera.has_value()) {
       T t;
-      t.view = &node.transformMatrix_;
+      t.node = slot;
       t.perspective = node.camera->projectionMatrix();
       cameras[node.camera->name] = std::move(t);
     }
+    ++slot;
   }
 }
 
+void App::closeScene() {
+  is_scene_loaded = false;
+  my_scene.cancelLoad();
+  my_scene.unload();
+
+  std::erase_if(cameras, [](const auto& camera) { return camera.second.node != -1; });
+  active_camera = "Default";
+}
+
+// Rolling per-scope graphs with percentiles over the last Profiler::historySize frames a scope ran in
+void App::putProfiler() {
+  ImGui::Begin("Profiler", &profiler_window_visible);
+
+  if(profiler.capturing())
+    ImGui::TextUnformatted("Capturing...");
+  else if(ImGui::Button("Capture trace"))
+    profiler.capture(trace_frames, "trace.json");
+  ImGui::SameLine();
+  ImGui::SliderInt("Frames", &trace_frames, 1, 1000);
+
+  if(ImGui::BeginTable("Scopes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("p50 ms");
+    ImGui::TableSetupColumn("p95 ms");
+    ImGui::TableSetupColumn("p99 ms");
+    ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableHeadersRow();
+
+    for(const util::Profiler::scope_stats_t& scope : profiler.scopes()) {
+      const std::string label = std::format("{} {}", scope.track == util::Profiler::track_t::gpu ? "GPU" : "CPU", scope.name);
+
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(label.c_str());
+      for(const float p : {0.5f, 0.95f, 0.99f}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", scope.percentile(p));
+      }
+
+      ImGui::TableNextColumn();
+      ImGui::PushID(label.c_str());
+      ImGui::PlotLines("##history", std::data(scope.samples), static_cast<int>(std::size(scope.samples)), static_cast<int>(scope.next % std::size(scope.samples)),
+                       std::format("{:.3f}", scope.last()).c_str(), 0.0f, FLT_MAX, ImVec2(-1.0f, 24.0f));
+      ImGui::PopID();
+    }
+
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+void App::putLoadProgress() {
+  const Scene::load_stage_t stage = my_scene.loadStage();
+  if(stage == Scene::load_stage_t::idle)
+    return;
+
+  std::string overlay;
+  switch(stage) {
+    using enum Scene::load_stage_t;
+  case reading: overlay = "Reading file"; break;
+  case parsing:  overlay = "Parsing"; break;
+  case decoding: overlay = std::format("Decoding images {}/{}", my_scene.decodedImageCount(), my_scene.loadImageCount()); break;
+  case optimizing: overlay = "Optimizing meshes"; break;
+  case baking:   overlay = "Writing scene cache"; break;
+  default:       overlay = "Uploading"; break;
+  }
+
+  float fraction = static_cast<float>(std::to_underlying(stage)) / std::to_underlying(Scene::load_stage_t::parsed);
+  if(stage == Scene::load_stage_t::decoding && my_scene.loadImageCount() != 0)
+    fraction += static_cast<float>(my_scene.decodedImageCount()) / my_scene.loadImageCount() / std::to_underlying(Scene::load_stage_t::parsed);
+  ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), overlay.c_str());
+
+  if(ImGui::Button("Cancel"))
+    closeScene();
+}
+
 void App::onKey(int key, int action, int mods) {
   switch(action) {
   case GLFW_PRESS:
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include <GL/glew.h>
 
@@ -9,7 +12,10 @@
 
 #include "AppBase.h"
 #include "Scene.h"
-#include "ShaderLoader.h"
+#include "ProgramVariants.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "RenderQueue.h"
 
 namespace ImGui {
 class FileBrowser;
@@ -28,8 +34,15 @@ private:
   void putMenuBar();
 
   void loadSceneCameras();
+  void closeScene();
+  void putLoadProgress();
+  void putProfiler();
+
+  void buildRenderQueue(const glm::mat4x4& view, const glm::mat4x4& projection);
+  void submitRenderQueue(const glm::mat4x4& view, const glm::mat4x4& projection);
+
   struct T {
-    glm::mat4x4* view;
+    int node = -1; // scene node the camera is attached to, -1 for the default camera
     glm::mat4x4 perspective;
   };
 
@@ -39,54 +52,82 @@ private:
 private:
 
   bool imgui_demo_window_visible = false;
+  bool profiler_window_visible = false;
+  int trace_frames = 120; // frames a trace capture covers
 
   bool is_scene_loaded = false;
+  bool background_loading = true;
+
+  // flat tests every node with cullBounds, hierarchy walks Scene::bvh
+  enum class cull_mode_t { none, flat, hierarchy };
+  cull_mode_t cull_mode = cull_mode_t::hierarchy; // default
+
+  bool lod_selection = true;
+  float lod_threshold = 1.0f; // pixels of simplification error a LOD may show
   ImGui::FileBrowser* p_fileDialog;
 
   Camera defaultCamera;
   glm::mat4x4 defaultView;
 
-  GLuint programID;
-
-  GLuint viewMatrixLocation;
-  GLuint projectionMatrixLocation;
-  GLuint transformMatrixLocation;
-
-  struct {
-    GLuint baseColorLocation;
-    GLuint roughnessLocation;
-    GLuint metallicLocation;
-
-    struct {
-      GLuint isDefined;
-      GLuint sampler;
-    } baseColorTextureLocation;
-
-    struct {
-      GLuint isDefined;
-      GLuint sampler;
-    } metallicRoughnessTextureLocation;
-  } pbr;
-
-  struct {
-    GLuint isDefined;
-    GLuint sampler;
-    GLuint scale;
-  } normalTextureLocation;
-
-  struct {
-    GLuint isDefined;
-    GLuint sampler;
-    GLuint strength;
-  } occlusionTextureLocation;
-
-  GLuint emissiveFactorLocation;
-  struct {
-    GLuint isDefined;
-    GLuint sampler;
-  } emissiveTextureLocation;
-
-  util::ShaderLoader shaderLoader;
+  // layout(location) of the uniforms in vertexShader.vert, the same in every program variant
+  enum uniformLocation_t : GLint {
+    viewMatrixLocation = 0,
+    projectionMatrixLocation = 1,
+  };
+
+  RenderQueue renderQueue;
+
+  std::vector<std::uint8_t> visibleNodes; // per scene slot, flat culling
+  std::vector<int> visibleSlots;          // hierarchy culling
+  std::size_t culledDraws = 0;            // by the last buildRenderQueue
+  std::size_t totalDraws = 0;
+  std::size_t drawnTriangles = 0; // by the last submitRenderQueue
+
+  // std430 layout of DrawData_t in vertexShader.vert
+  struct draw_data_t {
+    glm::mat4x4 transform;
+    std::uint32_t materialIndex; // into Scene::materials
+    std::uint32_t vertexFormat;  // primitive_buffer_t::vertexFormat, selects the attribute decode
+    std::uint32_t firstJoint;    // into Scene::jointPalette, noSkin for unskinned draws
+
+    std::uint32_t firstMorphWeight; // into Scene::activeMorphWeights
+    std::uint32_t morphWeightCount; // 0 without active targets
+    std::uint32_t firstMorphDelta;  // primitive_buffer_t::morphTargets
+    std::uint32_t morphVertexCount;
+    std::uint32_t morphAttributes;
+  };
+
+  static constexpr std::uint32_t noSkin = -1;
+
+  // one instanced draw: a primitive at one level, for every node placing it
+  struct draw_group_t {
+    const draw_item_t* item; // first instance, its state applies to the whole group
+    lod_range_t level;
+    std::uint32_t firstInstance; // into drawData
+    std::uint32_t instanceCount;
+  };
+
+  // one GL draw call, several groups only for glMultiDrawElementsIndirect of an arena
+  struct draw_batch_t {
+    std::uint32_t firstGroup; // into drawGroups and drawCommands
+    std::uint32_t groupCount;
+  };
+
+  std::vector<draw_batch_t> drawBatches;
+  std::vector<draw_group_t> drawGroups;
+  std::vector<draw_data_t> drawData;
+  std::vector<draw_elements_indirect_command_t> drawCommands; // per group
+
+  std::vector<std::uint32_t> instanceGroups;                  // per instance in queue order, before they're sorted into drawData
+  std::vector<draw_data_t> instanceData;
+  std::unordered_map<std::uint64_t, std::uint32_t> batchGroups; // groups of the current arena batch
+
+  GLuint drawDataBufferID; // indexed by gl_BaseInstance + gl_InstanceID
+  GLuint drawCommandBufferID;
+
+  util::ProgramVariants programs; // fragment shader specialized on material_t::textureFlags
+  util::ThreadPool threadPool;
+  util::Profiler profiler;
 
   Scene my_scene;
 
@@ -0,0 +1,440 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <glm/common.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace {
+
+aabb_t merge(const aabb_t& a, const aabb_t& b) {
+  aabb_t result = a;
+  result.extend(b);
+  return result;
+}
+
+}
+
+void BoundingVolumeHierarchy::build(std::span<const int> items, std::span<const aabb_t> bounds) {
+  assert(std::size(items) == std::size(bounds));
+
+  clear();
+  if(std::empty(items))
+    return;
+
+  leaves.assign(*std::ranges::max_element(items) + 1, -1);
+  nodes.reserve(2 * std::size(items) - 1);
+
+  std::vector<glm::vec3> centroids;
+  centroids.reserve(std::size(bounds));
+  for(const aabb_t& box : bounds)
+    centroids.push_back((box.min + box.max) * 0.5f);
+
+  std::vector<int> order(std::size(items));
+  std::iota(std::begin(order), std::end(order), 0);
+
+  root = buildRange(order, items, bounds, centroids, -1);
+  itemCount = std::size(items);
+}
+
+void BoundingVolumeHierarchy::clear() {
+  nodes.clear();
+  freeNodes.clear();
+  leaves.clear();
+  root = -1;
+  itemCount = 0;
+}
+
+// order indexes items, bounds and centroids, it's partitioned in place
+int BoundingVolumeHierarchy::buildRange(std::span<int> order, std::span<const int> items, std::span<const aabb_t> bounds, std::span<const glm::vec3> centroids, int parent) {
+  const int node = allocateNode();
+  nodes[node].parent = parent;
+
+  if(std::size(order) == 1) {
+    nodes[node].item = items[order[0]];
+    nodes[node].bounds = bounds[order[0]];
+    leaves[items[order[0]]] = node;
+    return node;
+  }
+
+  aabb_t centroidBounds;
+  for(int i : order)
+    centroidBounds.extend(centroids[i]);
+
+  const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+  const int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+
+  std::size_t split = 0;
+
+  if(extent[axis] > 0.0f) { // cheapest of the binCount - 1 planes by surface area heuristic
+    constexpr int binCount = 16;
+
+    const auto binOf = [&](int i) {
+      return std::min(binCount - 1, static_cast<int>((centroids[i][axis] - centroidBounds.min[axis]) / extent[axis] * binCount));
+    };
+
+    struct bin_t {
+      aabb_t bounds;
+      std::size_t count = 0;
+    };
+
+    std::array<bin_t, binCount> bins;
+    for(int i : order) {
+      bin_t& bin = bins[binOf(i)];
+      bin.bounds.extend(bounds[i]);
+      ++bin.count;
+    }
+
+    std::array<float, binCount> rightCosts{}; // of bins b and above
+    aabb_t right;
+    for(std::size_t b = binCount - 1, count = 0; b > 0; --b) {
+      right.extend(bins[b].bounds);
+      count += bins[b].count;
+      rightCosts[b] = right.surfaceArea() * count;
+    }
+
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestBin = -1;
+
+    aabb_t left;
+    for(std::size_t b = 0, count = 0; b < binCount - 1; ++b) {
+      left.extend(bins[b].bounds);
+      count += bins[b].count;
+
+      if(count == 0 || count == std::size(order))
+        continue;
+
+      if(const float cost = left.surfaceArea() * count + rightCosts[b + 1]; cost < bestCost) {
+        bestCost = cost;
+        bestBin = static_cast<int>(b);
+      }
+    }
+
+    if(bestBin != -1)
+      split = std::ranges::partition(order, [&](int i) { return binOf(i) <= bestBin; }).begin() - std::begin(order);
+  }
+
+  if(split == 0 || split == std::size(order)) { // coincident centroids, halve by count
+    split = std::size(order) / 2;
+    std::ranges::nth_element(order, std::begin(order) + split, {}, [&](int i) { return centroids[i][axis]; });
+  }
+
+  const int left = buildRange(order.first(split), items, bounds, centroids, node);
+  const int right = buildRange(order.subspan(split), items, bounds, centroids, node);
+
+  nodes[node].left = left;
+  nodes[node].right = right;
+  nodes[node].bounds = merge(nodes[left].bounds, nodes[right].bounds);
+
+  return node;
+}
+
+// Box2D style descent: stop where pairing with the current node is cheaper than the cheapest child's lower bound
+void BoundingVolumeHierarchy::insert(int item, const aabb_t& bounds) {
+  if(item >= std::ssize(leaves))
+    leaves.resize(item + 1, -1);
+  assert(leaves[item] == -1);
+
+  const int leaf = allocateNode();
+  nodes[leaf].bounds = bounds;
+  nodes[leaf].item = item;
+  leaves[item] = leaf;
+  ++itemCount;
+
+  if(root == -1) {
+    root = leaf;
+    return;
+  }
+
+  int sibling = root;
+  while(nodes[sibling].left != -1) {
+    const tree_node_t& node = nodes[sibling];
+
+    const float area = node.bounds.surfaceArea();
+    const float combinedArea = merge(node.bounds, bounds).surfaceArea();
+
+    const float cost = 2.0f * combinedArea;                    // new parent of this node and the leaf
+    const float inheritedCost = 2.0f * (combinedArea - area); // every ancestor below grows by this much
+
+    const auto descendCost = [&](int child) {
+      const float childArea = merge(nodes[child].bounds, bounds).surfaceArea();
+      return (nodes[child].left == -1 ? childArea : childArea - nodes[child].bounds.surfaceArea()) + inheritedCost;
+    };
+
+    const float leftCost = descendCost(node.left);
+    const float rightCost = descendCost(node.right);
+
+    if(cost < leftCost && cost < rightCost)
+      break;
+
+    sibling = leftCost < rightCost ? node.left : node.right;
+  }
+
+  const int oldParent = nodes[sibling].parent;
+  const int newParent = allocateNode();
+
+  nodes[newParent].parent = oldParent;
+  nodes[newParent].left = sibling;
+  nodes[newParent].right = leaf;
+  nodes[sibling].parent = newParent;
+  nodes[leaf].parent = newParent;
+
+  if(oldParent == -1)
+    root = newParent;
+  else
+    replaceChild(oldParent, sibling, newParent);
+
+  refit(newParent);
+}
+
+void BoundingVolumeHierarchy::remove(int item) {
+  assert(contains(item));
+
+  const int leaf = std::exchange(leaves[item], -1);
+  --itemCount;
+
+  if(leaf == root) {
+    root = -1;
+    freeNode(leaf);
+    return;
+  }
+
+  const int parent = nodes[leaf].parent;
+  const int grandParent = nodes[parent].parent;
+  const int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+  nodes[sibling].parent = grandParent;
+
+  if(grandParent == -1) {
+    root = sibling;
+  } else {
+    replaceChild(grandParent, parent, sibling);
+    refit(grandParent);
+  }
+
+  freeNode(parent);
+  freeNode(leaf);
+}
+
+void BoundingVolumeHierarchy::update(int item, const aabb_t& bounds) {
+  assert(contains(item));
+
+  const int leaf = leaves[item];
+  nodes[leaf].bounds = bounds;
+
+  if(nodes[leaf].parent != -1)
+    refit(nodes[leaf].parent);
+}
+
+void BoundingVolumeHierarchy::replaceChild(int parent, int child, int replacement) {
+  if(nodes[parent].left == child)
+    nodes[parent].left = replacement;
+  else
+    nodes[parent].right = replacement;
+}
+
+void BoundingVolumeHierarchy::refit(int node) {
+  for(; node != -1; node = nodes[node].parent) {
+    nodes[node].bounds = merge(nodes[nodes[node].left].bounds, nodes[nodes[node].right].bounds);
+    rotate(node);
+  }
+}
+
+// Kopta et al.: swapping a child with one of its sibling's children keeps node's bounds but can shrink the sibling.
+// Of the four swaps, the one that shrinks it most wins.
+void BoundingVolumeHierarchy::rotate(int node) {
+  const int left = nodes[node].left;
+  const int right = nodes[node].right;
+
+  struct rotation_t {
+    int child;      // moves down
+    int grandChild; // moves up
+    int kept;       // stays next to child
+  };
+
+  rotation_t best{-1, -1, -1};
+  float bestGain = 0.0f;
+
+  const auto consider = [&](int child, int inner) {
+    if(nodes[inner].left == -1)
+      return;
+
+    const float area = nodes[inner].bounds.surfaceArea();
+    for(auto [grandChild, kept] : {std::pair(nodes[inner].left, nodes[inner].right), std::pair(nodes[inner].right, nodes[inner].left)}) {
+      const float newArea = merge(nodes[child].bounds, nodes[kept].bounds).surfaceArea();
+      if(area - newArea > bestGain) {
+        bestGain = area - newArea;
+        best = {child, grandChild, kept};
+      }
+    }
+  };
+
+  consider(left, right);
+  consider(right, left);
+
+  if(best.child == -1)
+    return;
+
+  const int inner = nodes[best.grandChild].parent;
+
+  replaceChild(node, best.child, best.grandChild);
+  replaceChild(inner, best.grandChild, best.child);
+  nodes[best.grandChild].parent = node;
+  nodes[best.child].parent = inner;
+
+  nodes[inner].bounds = merge(nodes[best.child].bounds, nodes[best.kept].bounds);
+}
+
+// Planes a node is already fully inside of are dropped for its subtree, fully inside nodes are taken whole
+void BoundingVolumeHierarchy::queryFrustum(const frustum_t& frustum, std::vector<int>& items) const {
+  if(root == -1)
+    return;
+
+  std::vector<std::pair<int, std::uint32_t>> stack{{root, (1u << std::size(frustum.planes)) - 1}};
+
+  while(!std::empty(stack)) {
+    auto [node, planeMask] = stack.back();
+    stack.pop_back();
+
+    const aabb_t& box = nodes[node].bounds;
+
+    bool outside = false;
+    for(std::size_t p = 0; p < std::size(frustum.planes) && !outside; ++p) {
+      if(!(planeMask & (1u << p)))
+        continue;
+
+      const glm::vec4& plane = frustum.planes[p];
+      const glm::vec3 normal{plane};
+
+      const glm::vec3 farthest{normal.x >= 0.0f ? box.max.x : box.min.x, normal.y >= 0.0f ? box.max.y : box.min.y, normal.z >= 0.0f ? box.max.z : box.min.z};
+      const glm::vec3 nearest{normal.x >= 0.0f ? box.min.x : box.max.x, normal.y >= 0.0f ? box.min.y : box.max.y, normal.z >= 0.0f ? box.min.z : box.max.z};
+
+      if(glm::dot(normal, farthest) + plane.w < 0.0f)
+        outside = true;
+      else if(glm::dot(normal, nearest) + plane.w >= 0.0f)
+        planeMask &= ~(1u << p);
+    }
+
+    if(outside)
+      continue;
+
+    if(planeMask == 0)
+      collectLeaves(node, items);
+    else if(nodes[node].left == -1)
+      items.push_back(nodes[node].item);
+    else
+      stack.insert(std::end(stack), {{nodes[node].left, planeMask}, {nodes[node].right, planeMask}});
+  }
+}
+
+void BoundingVolumeHierarchy::queryOverlap(const aabb_t& box, std::vector<int>& items) const {
+  if(root == -1)
+    return;
+
+  std::vector<int> stack{root};
+
+  while(!std::empty(stack)) {
+    const int node = stack.back();
+    stack.pop_back();
+
+    if(!nodes[node].bounds.overlaps(box))
+      continue;
+
+    if(nodes[node].left == -1)
+      items.push_back(nodes[node].item);
+    else
+      stack.insert(std::end(stack), {nodes[node].left, nodes[node].right});
+  }
+}
+
+void BoundingVolumeHierarchy::querySphere(const glm::vec3& center, float radius, std::vector<int>& items) const {
+  if(root == -1)
+    return;
+
+  std::vector<int> stack{root};
+
+  while(!std::empty(stack)) {
+    const int node = stack.back();
+    stack.pop_back();
+
+    const aabb_t& box = nodes[node].bounds;
+    const glm::vec3 offset = center - glm::clamp(center, box.min, box.max);
+    if(glm::dot(offset, offset) > radius * radius)
+      continue;
+
+    if(nodes[node].left == -1)
+      items.push_back(nodes[node].item);
+    else
+      stack.insert(std::end(stack), {nodes[node].left, nodes[node].right});
+  }
+}
+
+// slab test, direction doesn't need to be normalized, maxDistance is in its units
+void BoundingVolumeHierarchy::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<int>& items) const {
+  if(root == -1)
+    return;
+
+  const glm::vec3 inverseDirection = 1.0f / direction;
+
+  std::vector<int> stack{root};
+
+  while(!std::empty(stack)) {
+    const int node = stack.back();
+    stack.pop_back();
+
+    const aabb_t& box = nodes[node].bounds;
+    const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar = glm::max(t0, t1);
+
+    const float enter = std::max({tNear.x, tNear.y, tNear.z, 0.0f});
+    const float exit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+    if(enter > exit)
+      continue;
+
+    if(nodes[node].left == -1)
+      items.push_back(nodes[node].item);
+    else
+      stack.insert(std::end(stack), {nodes[node].left, nodes[node].right});
+  }
+}
+
+void BoundingVolumeHierarchy::collectLeaves(int node, std::vector<int>& items) const {
+  std::vector<int> stack{node};
+
+  while(!std::empty(stack)) {
+    const int next = stack.back();
+    stack.pop_back();
+
+    if(nodes[next].left == -1)
+      items.push_back(nodes[next].item);
+    else
+      stack.insert(std::end(stack), {nodes[next].left, nodes[next].right});
+  }
+}
+
+int BoundingVolumeHierarchy::allocateNode() {
+  if(!std::empty(freeNodes)) {
+    const int node = freeNodes.back();
+    freeNodes.pop_back();
+    nodes[node] = {};
+    return node;
+  }
+
+  nodes.emplace_back();
+  return static_cast<int>(std::size(nodes)) - 1;
+}
+
+void BoundingVolumeHierarchy::freeNode(int node) {
+  freeNodes.push_back(node);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "Bounds.h"
+
+// Dynamic AABB tree with one item per leaf. build() splits top down by binned SAH, update() refits a moved leaf's
+// ancestors and rotates them where that shrinks the tree, so animated scenes don't need rebuilding.
+// Items are caller ids, scene slots for Scene.
+struct BoundingVolumeHierarchy {
+  void build(std::span<const int> items, std::span<const aabb_t> bounds);
+  void clear();
+
+  void insert(int item, const aabb_t& bounds);
+  void remove(int item);
+  void update(int item, const aabb_t& bounds);
+
+  bool contains(int item) const {
+    return item >= 0 && item < std::ssize(leaves) && leaves[item] != -1;
+  }
+
+  // Queries append the items whose box passes, in no particular order
+  void queryFrustum(const frustum_t& frustum, std::vector<int>& items) const;
+  void queryOverlap(const aabb_t& box, std::vector<int>& items) const;
+  void querySphere(const glm::vec3& center, float radius, std::vector<int>& items) const;
+  void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<int>& items) const;
+
+  std::size_t size() const {
+    return itemCount;
+  }
+
+private:
+  struct tree_node_t {
+    aabb_t bounds;
+    int parent = -1;
+    int left = -1; // both -1 for leaves
+    int right = -1;
+    int item = -1; // leaves only
+  };
+
+  std::vector<tree_node_t> nodes;
+  std::vector<int> freeNodes;
+  std::vector<int> leaves; // item to leaf node, -1 when the item isn't in the tree
+  int root = -1;
+  std::size_t itemCount = 0;
+
+  int allocateNode();
+  void freeNode(int node);
+
+  int buildRange(std::span<int> order, std::span<const int> items, std::span<const aabb_t> bounds, std::span<const glm::vec3> centroids, int parent);
+  void replaceChild(int parent, int child, int replacement);
+  void refit(int node); // node and its ancestors
+  void rotate(int node);
+
+  void collectLeaves(int node, std::vector<int>& items) const;
+};
@@ -0,0 +1,183 @@
+#include "Bounds.h"
+
+#include <glm/common.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace {
+
+constexpr std::size_t boundsPadding = 8; // AVX lanes
+
+// the corner of box furthest along the plane normal, the box is outside when even that one is behind the plane
+bool intersects(const glm::vec4& plane, const glm::vec3& min, const glm::vec3& max) {
+  const glm::vec3 p{plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z};
+  return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w >= 0.0f;
+}
+
+}
+
+void aabb_t::extend(const glm::vec3& point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void aabb_t::extend(const aabb_t& box) {
+  min = glm::min(min, box.min);
+  max = glm::max(max, box.max);
+}
+
+float aabb_t::surfaceArea() const {
+  if(empty())
+    return 0.0f;
+
+  const glm::vec3 extent = max - min;
+  return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+bool aabb_t::overlaps(const aabb_t& box) const {
+  return min.x <= box.max.x && max.x >= box.min.x && min.y <= box.max.y && max.y >= box.min.y && min.z <= box.max.z && max.z >= box.min.z;
+}
+
+// Arvo: each output axis takes the smaller and the larger product of every matrix column with the box extent
+aabb_t transformBounds(const aabb_t& box, const glm::mat4x4& matrix) {
+  if(box.empty())
+    return box;
+
+  aabb_t result;
+  result.min = result.max = glm::vec3(matrix[3]);
+
+  for(int column = 0; column < 3; ++column) {
+    const glm::vec3 a = glm::vec3(matrix[column]) * box.min[column];
+    const glm::vec3 b = glm::vec3(matrix[column]) * box.max[column];
+    result.min += glm::min(a, b);
+    result.max += glm::max(a, b);
+  }
+
+  return result;
+}
+
+void bounds_soa_t::resize(std::size_t count) {
+  this->count = count;
+
+  const std::size_t padded = (count + boundsPadding - 1) / boundsPadding * boundsPadding;
+  for(std::vector<float>* min : {&minX, &minY, &minZ})
+    min->assign(padded, std::numeric_limits<float>::infinity());
+  for(std::vector<float>* max : {&maxX, &maxY, &maxZ})
+    max->assign(padded, -std::numeric_limits<float>::infinity());
+}
+
+void bounds_soa_t::set(std::size_t i, const aabb_t& box) {
+  assert(i < count);
+
+  minX[i] = box.min.x;
+  minY[i] = box.min.y;
+  minZ[i] = box.min.z;
+  maxX[i] = box.max.x;
+  maxY[i] = box.max.y;
+  maxZ[i] = box.max.z;
+}
+
+aabb_t bounds_soa_t::get(std::size_t i) const {
+  assert(i < count);
+
+  return {{minX[i], minY[i], minZ[i]}, {maxX[i], maxY[i], maxZ[i]}};
+}
+
+// Gribb and Hartmann, rows of the clip transform combined so -w <= x, y, z <= w
+frustum_t extractFrustum(const glm::mat4x4& viewProjection) {
+  const glm::mat4x4 rows = glm::transpose(viewProjection);
+
+  return {{
+      rows[3] + rows[0], // left
+      rows[3] - rows[0], // right
+      rows[3] + rows[1], // bottom
+      rows[3] - rows[1], // top
+      rows[3] + rows[2], // near
+      rows[3] - rows[2], // far
+  }};
+}
+
+std::size_t cullBounds(const frustum_t& frustum, const bounds_soa_t& bounds, std::span<std::uint8_t> visible) {
+  assert(std::size(visible) >= bounds.size());
+
+  std::size_t visibleCount = 0;
+  std::size_t i = 0;
+
+#if defined(__AVX__)
+  for(; i < bounds.size(); i += 8) {
+    const __m256 minX = _mm256_loadu_ps(&bounds.minX[i]), maxX = _mm256_loadu_ps(&bounds.maxX[i]);
+    const __m256 minY = _mm256_loadu_ps(&bounds.minY[i]), maxY = _mm256_loadu_ps(&bounds.maxY[i]);
+    const __m256 minZ = _mm256_loadu_ps(&bounds.minZ[i]), maxZ = _mm256_loadu_ps(&bounds.maxZ[i]);
+
+    __m256 inside = _mm256_cmp_ps(minX, maxX, _CMP_LE_OQ); // not empty
+
+    for(const glm::vec4& plane : frustum.planes) {
+      const __m256 px = plane.x >= 0.0f ? maxX : minX;
+      const __m256 py = plane.y >= 0.0f ? maxY : minY;
+      const __m256 pz = plane.z >= 0.0f ? maxZ : minZ;
+
+      const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), px), _mm256_mul_ps(_mm256_set1_ps(plane.y), py)),
+                                            _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), pz), _mm256_set1_ps(plane.w)));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+
+    const int mask = _mm256_movemask_ps(inside);
+    for(std::size_t lane = 0; lane < 8 && i + lane < bounds.size(); ++lane) {
+      visible[i + lane] = (mask >> lane) & 1;
+      visibleCount += visible[i + lane];
+    }
+  }
+#elif defined(__SSE__) || defined(_M_X64)
+  for(; i < bounds.size(); i += 4) {
+    const __m128 minX = _mm_loadu_ps(&bounds.minX[i]), maxX = _mm_loadu_ps(&bounds.maxX[i]);
+    const __m128 minY = _mm_loadu_ps(&bounds.minY[i]), maxY = _mm_loadu_ps(&bounds.maxY[i]);
+    const __m128 minZ = _mm_loadu_ps(&bounds.minZ[i]), maxZ = _mm_loadu_ps(&bounds.maxZ[i]);
+
+    __m128 inside = _mm_cmple_ps(minX, maxX); // not empty
+
+    for(const glm::vec4& plane : frustum.planes) {
+      const __m128 px = plane.x >= 0.0f ? maxX : minX;
+      const __m128 py = plane.y >= 0.0f ? maxY : minY;
+      const __m128 pz = plane.z >= 0.0f ? maxZ : minZ;
+
+      const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), px), _mm_mul_ps(_mm_set1_ps(plane.y), py)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), pz), _mm_set1_ps(plane.w)));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+    }
+
+    const int mask = _mm_movemask_ps(inside);
+    for(std::size_t lane = 0; lane < 4 && i + lane < bounds.size(); ++lane) {
+      visible[i + lane] = (mask >> lane) & 1;
+      visibleCount += visible[i + lane];
+    }
+  }
+#endif
+
+  for(; i < bounds.size(); ++i) {
+    const glm::vec3 min{bounds.minX[i], bounds.minY[i], bounds.minZ[i]};
+    const glm::vec3 max{bounds.maxX[i], bounds.maxY[i], bounds.maxZ[i]};
+
+    bool inside = min.x <= max.x;
+    for(const glm::vec4& plane : frustum.planes)
+      inside = inside && intersects(plane, min, max);
+
+    visible[i] = inside;
+    visibleCount += inside;
+  }
+
+  return visibleCount;
+}
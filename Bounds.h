@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+struct aabb_t {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+  bool empty() const {
+    return min.x > max.x;
+  }
+
+  void extend(const glm::vec3& point);
+  void extend(const aabb_t& box);
+
+  float surfaceArea() const; // 0 when empty
+  bool overlaps(const aabb_t& box) const;
+};
+
+// Box around the transformed corners of box
+aabb_t transformBounds(const aabb_t& box, const glm::mat4x4& matrix);
+
+// Boxes in structure of arrays form. Storage is padded with empty boxes to a multiple of the widest kernel, so it reads whole registers.
+struct bounds_soa_t {
+  std::vector<float> minX, minY, minZ;
+  std::vector<float> maxX, maxY, maxZ;
+
+  void resize(std::size_t count);
+  void set(std::size_t i, const aabb_t& box);
+  aabb_t get(std::size_t i) const;
+
+  std::size_t size() const {
+    return count;
+  }
+
+private:
+  std::size_t count = 0;
+};
+
+// Planes face inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+struct frustum_t {
+  std::array<glm::vec4, 6> planes;
+};
+
+frustum_t extractFrustum(const glm::mat4x4& viewProjection);
+
+// visible[i] = 1 when box i intersects the frustum, empty boxes are never visible. Returns the number of visible boxes.
+// 8 boxes per iteration with AVX, 4 with SSE, one at a time otherwise.
+std::size_t cullBounds(const frustum_t& frustum, const bounds_soa_t& bounds, std::span<std::uint8_t> visible);
@@ -0,0 +1,249 @@
+#include <GL/glew.h>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "GeometryArena.h"
+
+namespace {
+
+struct stream_layout_t {
+  vertexStream_t stream;
+  vertexAttribute_t attribute;
+  GLint components;
+
+  // quantized: component type and count of the attribute, bytes per vertex with padding to 4
+  GLenum quantizedType;
+  GLint quantizedComponents;
+  GLboolean quantizedNormalized;
+  GLuint quantizedSize;
+};
+
+// in interleaved order
+constexpr std::array<stream_layout_t, 4> streamLayouts = {{
+    {positionStream, positionAttribute, 3, GL_UNSIGNED_SHORT, 3, GL_TRUE, 8},
+    {normalStream, normalAttribute, 3, GL_SHORT, 2, GL_TRUE, 4},   // octahedral
+    {tangentStream, tangentAttribute, 4, GL_SHORT, 4, GL_TRUE, 8}, // octahedral xy, 0, bitangent sign
+    {texcoordStream, texcoordAttribute, 2, GL_HALF_FLOAT, 2, GL_FALSE, 4},
+}};
+
+std::uint16_t unorm16(float value) {
+  return static_cast<std::uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+std::int16_t snorm16(float value) {
+  return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// round to nearest even, overflow to infinity
+std::uint16_t halfFloat(float value) {
+  const std::uint16_t sign = std::bit_cast<std::uint32_t>(value) >> 16 & 0x8000;
+  const float magnitude = std::fabs(value);
+
+  if(std::isnan(value))
+    return sign | 0x7E00;
+  if(magnitude >= 65520.0f)
+    return sign | 0x7C00;
+  if(magnitude < 6.103515625e-05f) // subnormal, multiples of 2^-24
+    return sign | static_cast<std::uint16_t>(std::nearbyint(magnitude * 16777216.0f));
+
+  std::uint32_t bits = std::bit_cast<std::uint32_t>(magnitude);
+  bits += 0x0FFF + (bits >> 13 & 1);
+  return sign | static_cast<std::uint16_t>((bits >> 13) - (112 << 10)); // rebias the exponent from 127 to 15
+}
+
+// unit vector onto the octahedron, the lower half folded over the diagonals
+std::array<float, 2> octahedral(float x, float y, float z) {
+  const float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+  if(l1 == 0.0f)
+    return {0.0f, 0.0f};
+
+  x /= l1;
+  y /= l1;
+  if(z < 0.0f) {
+    const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    const float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    return {foldedX, foldedY};
+  }
+
+  return {x, y};
+}
+
+template<typename T>
+void append(std::vector<unsigned char>& out, const T& value) {
+  const auto bytes = std::bit_cast<std::array<unsigned char, sizeof(T)>>(value);
+  out.insert(std::end(out), std::begin(bytes), std::end(bytes));
+}
+
+}
+
+glm::mat4x4 vertex_quantization_t::matrix() const {
+  return glm::scale(glm::translate(glm::mat4x4(1.0f), offset), scale);
+}
+
+std::uint32_t vertexStride(std::uint32_t format) {
+  std::uint32_t stride = 0;
+  for(const stream_layout_t& layout : streamLayouts)
+    if(format & layout.stream)
+      stride += format & quantizedStreams ? layout.quantizedSize : layout.components * sizeof(float);
+
+  return stride;
+}
+
+void appendVertices(std::vector<unsigned char>& out, const vertex_streams_t& streams, std::uint32_t format, const vertex_quantization_t& quantization) {
+  const std::uint32_t n = streams.vertexCount();
+  out.reserve(std::size(out) + n * vertexStride(format));
+
+  const auto floats = [&](const std::vector<float>& stream, std::uint32_t v, std::size_t components) {
+    const auto first = std::data(stream) + v * components;
+    out.insert(std::end(out), reinterpret_cast<const unsigned char*>(first), reinterpret_cast<const unsigned char*>(first + components));
+  };
+
+  for(std::uint32_t v = 0; v < n; ++v) {
+    if(!(format & quantizedStreams)) {
+      floats(streams.positions, v, 3);
+      if(format & normalStream)
+        floats(streams.normals, v, 3);
+      if(format & tangentStream)
+        floats(streams.tangents, v, 4);
+      if(format & texcoordStream)
+        floats(streams.texcoords, v, 2);
+      continue;
+    }
+
+    const float* p = std::data(streams.positions) + v * 3;
+    const glm::vec3 t = (glm::vec3(p[0], p[1], p[2]) - quantization.offset) / quantization.scale;
+    append(out, std::array<std::uint16_t, 4>{unorm16(t.x), unorm16(t.y), unorm16(t.z), 0});
+
+    if(format & normalStream) {
+      const float* normal = std::data(streams.normals) + v * 3;
+      const auto [x, y] = octahedral(normal[0], normal[1], normal[2]);
+      append(out, std::array<std::int16_t, 2>{snorm16(x), snorm16(y)});
+    }
+
+    if(format & tangentStream) {
+      const float* tangent = std::data(streams.tangents) + v * 4;
+      const auto [x, y] = octahedral(tangent[0], tangent[1], tangent[2]);
+      append(out, std::array<std::int16_t, 4>{snorm16(x), snorm16(y), 0, snorm16(tangent[3] < 0.0f ? -1.0f : 1.0f)});
+    }
+
+    if(format & texcoordStream) {
+      const float* uv = std::data(streams.texcoords) + v * 2;
+      append(out, std::array<std::uint16_t, 2>{halfFloat(uv[0]), halfFloat(uv[1])});
+    }
+  }
+}
+
+void setVertexFormat(GLuint vertexArrayID, std::uint32_t format, GLuint bindingIndex) {
+  const bool quantized = format & quantizedStreams;
+
+  for(GLuint offset = 0; const stream_layout_t& layout : streamLayouts) {
+    if(!(format & layout.stream))
+      continue;
+
+    if(quantized)
+      glVertexArrayAttribFormat(vertexArrayID, layout.attribute, layout.quantizedComponents, layout.quantizedType, layout.quantizedNormalized, offset);
+    else
+      glVertexArrayAttribFormat(vertexArrayID, layout.attribute, layout.components, GL_FLOAT, GL_FALSE, offset);
+
+    glVertexArrayAttribBinding(vertexArrayID, layout.attribute, bindingIndex);
+    glEnableVertexArrayAttrib(vertexArrayID, layout.attribute);
+
+    offset += quantized ? layout.quantizedSize : layout.components * sizeof(float);
+  }
+}
+
+std::uint32_t vertex_streams_t::format() const {
+  const std::size_t n = vertexCount();
+  if(n == 0)
+    return 0;
+
+  std::uint32_t format = positionStream;
+  if(std::size(normals) == n * 3)
+    format |= normalStream;
+  if(std::size(tangents) == n * 4)
+    format |= tangentStream;
+  if(std::size(texcoords) == n * 2)
+    format |= texcoordStream;
+
+  return format;
+}
+
+arena_range_t GeometryArenas::add(const vertex_streams_t& streams, std::uint32_t format, const vertex_quantization_t& quantization) {
+  auto it = std::ranges::find(arenas, format, &arena_t::format);
+  if(it == std::end(arenas)) {
+    arenas.push_back(arena_t{.format = format});
+    it = std::prev(std::end(arenas));
+  }
+
+  arena_t& arena = *it;
+
+  arena_range_t range;
+  range.arena = std::distance(std::begin(arenas), it);
+  range.firstIndex = std::size(arena.indices);
+  range.indexCount = std::size(streams.indices);
+  range.baseVertex = arena.vertexCount;
+
+  appendVertices(arena.vertices, streams, format, quantization);
+
+  arena.indices.insert(std::end(arena.indices), std::begin(streams.indices), std::end(streams.indices));
+  arena.vertexCount += streams.vertexCount();
+
+  return range;
+}
+
+std::uint32_t GeometryArenas::addIndices(const arena_range_t& range, std::span<const std::uint32_t> indices) {
+  arena_t& arena = arenas[range.arena];
+
+  const std::uint32_t firstIndex = std::size(arena.indices);
+  arena.indices.insert(std::end(arena.indices), std::begin(indices), std::end(indices));
+
+  return firstIndex;
+}
+
+void GeometryArenas::upload() {
+  for(arena_t& arena : arenas) {
+    if(arena.vertexArrayID != 0 || std::empty(arena.vertices) || std::empty(arena.indices))
+      continue;
+
+    glCreateVertexArrays(1, &arena.vertexArrayID);
+    glCreateBuffers(1, &arena.vertexBufferID);
+    glCreateBuffers(1, &arena.elementBufferID);
+
+    glNamedBufferStorage(arena.vertexBufferID, std::size(arena.vertices), std::data(arena.vertices), 0);
+    glNamedBufferStorage(arena.elementBufferID, std::size(arena.indices) * sizeof(std::uint32_t), std::data(arena.indices), 0);
+
+    glVertexArrayVertexBuffer(arena.vertexArrayID, 0, arena.vertexBufferID, 0, vertexStride(arena.format));
+    glVertexArrayElementBuffer(arena.vertexArrayID, arena.elementBufferID);
+    setVertexFormat(arena.vertexArrayID, arena.format, 0);
+
+    arena.vertices = {};
+    arena.indices = {};
+  }
+
+  assert(glGetError() == GL_NO_ERROR);
+}
+
+void GeometryArenas::unload() {
+  for(const arena_t& arena : arenas) {
+    if(glIsVertexArray(arena.vertexArrayID))
+      glDeleteVertexArrays(1, &arena.vertexArrayID);
+
+    if(glIsBuffer(arena.vertexBufferID))
+      glDeleteBuffers(1, &arena.vertexBufferID);
+
+    if(glIsBuffer(arena.elementBufferID))
+      glDeleteBuffers(1, &arena.elementBufferID);
+  }
+
+  arenas.clear();
+}
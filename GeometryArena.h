@@ -0,0 +1,97 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Fixed by layout(location) in vertexShader.vert, so one vertex array works with every program variant. TEXCOORD_n is at texcoordAttribute + n.
+enum vertexAttribute_t : GLuint {
+  positionAttribute = 0,
+  normalAttribute = 1,
+  tangentAttribute = 2,
+  texcoordAttribute = 3,
+  jointsAttribute = 8,  // JOINTS_0, integer
+  weightsAttribute = 9, // WEIGHTS_0
+};
+
+enum vertexStream_t : std::uint32_t {
+  positionStream = 1 << 0,
+  normalStream = 1 << 1,
+  tangentStream = 1 << 2,
+  texcoordStream = 1 << 3,
+
+  // not a stream: unorm16 positions in the mesh bounds, octahedral snorm16 normals and tangents, half float texture coordinates.
+  // About half the bytes of the float streams, decoded by vertexShader.vert.
+  quantizedStreams = 1 << 4,
+};
+
+// Maps unorm16 positions back to mesh space, one per glTF mesh
+struct vertex_quantization_t {
+  glm::vec3 offset{0.0f}; // bounds minimum
+  glm::vec3 scale{1.0f};  // bounds extent
+
+  glm::mat4x4 matrix() const; // folded into the draw transform, so the shader never sees it
+};
+
+// One primitive's vertex data, de-interleaved and converted to float
+struct vertex_streams_t {
+  std::vector<float> positions; // xyz
+  std::vector<float> normals;   // xyz
+  std::vector<float> tangents;  // xyzw
+  std::vector<float> texcoords; // uv, TEXCOORD_0
+  std::vector<std::uint32_t> indices;
+
+  std::uint32_t vertexCount() const {
+    return std::size(positions) / 3;
+  }
+
+  std::uint32_t format() const; // vertexStream_t bits of the streams present for every vertex
+};
+
+// Interleaved vertices in streamLayouts order, sized by the format's quantizedStreams bit
+std::uint32_t vertexStride(std::uint32_t format); // in bytes
+void appendVertices(std::vector<unsigned char>& out, const vertex_streams_t& streams, std::uint32_t format, const vertex_quantization_t& quantization);
+void setVertexFormat(GLuint vertexArrayID, std::uint32_t format, GLuint bindingIndex); // attribute formats of the layout, all reading from bindingIndex
+
+struct arena_range_t {
+  int arena = -1;
+  std::uint32_t firstIndex = 0;
+  std::uint32_t indexCount = 0;
+  std::int32_t baseVertex = 0;
+};
+
+// Matches the layout glMultiDrawElementsIndirect reads
+struct draw_elements_indirect_command_t {
+  std::uint32_t count;
+  std::uint32_t instanceCount;
+  std::uint32_t firstIndex;
+  std::int32_t baseVertex;
+  std::uint32_t baseInstance;
+};
+
+// Vertex and index data of many primitives sub-allocated into one vertex and one element buffer per vertex format
+struct GeometryArenas {
+  struct arena_t {
+    std::uint32_t format;
+
+    GLuint vertexArrayID = 0;
+    GLuint vertexBufferID = 0;
+    GLuint elementBufferID = 0;
+
+    std::vector<unsigned char> vertices; // interleaved, released after upload
+    std::vector<std::uint32_t> indices;
+    std::uint32_t vertexCount = 0;
+  };
+
+  std::vector<arena_t> arenas;
+
+  arena_range_t add(const vertex_streams_t& streams, std::uint32_t format, const vertex_quantization_t& quantization = {}); // format of streams, optionally | quantizedStreams
+  std::uint32_t addIndices(const arena_range_t& range, std::span<const std::uint32_t> indices); // more indices into range's vertices, returns their firstIndex
+  void upload();
+  void unload();
+};
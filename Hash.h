@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// FNV-1a, pass the previous result as hash to continue over several ranges
+inline std::uint64_t hashBytes(std::span<const unsigned char> bytes, std::uint64_t hash = 0xCBF29CE484222325) {
+  for(unsigned char byte : bytes) {
+    hash ^= byte;
+    hash *= 0x100000001B3;
+  }
+
+  return hash;
+}
+
+inline std::uint64_t hashString(std::string_view string, std::uint64_t hash = 0xCBF29CE484222325) {
+  return hashBytes({reinterpret_cast<const unsigned char*>(std::data(string)), std::size(string)}, hash);
+}
@@ -0,0 +1,282 @@
+#include "LevelOfDetail.h"
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t lodMinimumTriangles = 1024; // below that a draw costs more than its vertices
+constexpr std::size_t lodMaxLevels = 6;
+constexpr float lodMaxRelativeError = 0.05f; // of the mesh extent
+
+// symmetric 4x4: a00 a01 a02 a03 a11 a12 a13 a22 a23 a33
+struct quadric_t {
+  std::array<double, 10> a{};
+
+  quadric_t& operator+=(const quadric_t& q) {
+    for(std::size_t i = 0; i < std::size(a); ++i)
+      a[i] += q.a[i];
+    return *this;
+  }
+
+  // squared distance to the accumulated planes, area weighted
+  double error(const glm::vec3& p) const {
+    const double x = p.x, y = p.y, z = p.z;
+    const double e = a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y + a[7] * z * z + 2 * a[8] * z + a[9];
+    return std::max(e, 0.0);
+  }
+};
+
+quadric_t planeQuadric(const glm::vec3& n, double d, double weight) {
+  return {{weight * n.x * n.x, weight * n.x * n.y, weight * n.x * n.z, weight * n.x * d, weight * n.y * n.y, weight * n.y * n.z, weight * n.y * d, weight * n.z * n.z,
+           weight * n.z * d, weight * d * d}};
+}
+
+struct collapse_t {
+  std::uint32_t from;
+  std::uint32_t to;
+  float cost; // quadric error, squared distance
+};
+
+glm::vec3 position(std::span<const float> positions, std::uint32_t v) {
+  return {positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]};
+}
+
+// vertices that mustn't move: open borders would tear, seams (same position, other attributes) would crack
+std::vector<std::uint8_t> lockedVertices(std::span<const float> positions, std::span<const std::uint32_t> indices) {
+  const std::size_t vertexCount = std::size(positions) / 3;
+
+  struct position_hash_t {
+    std::size_t operator()(const glm::vec3& p) const {
+      return std::hash<std::uint32_t>{}(std::bit_cast<std::uint32_t>(p.x) * 73856093u ^ std::bit_cast<std::uint32_t>(p.y) * 19349663u ^ std::bit_cast<std::uint32_t>(p.z) * 83492791u);
+    }
+  };
+
+  std::unordered_map<glm::vec3, std::uint32_t, position_hash_t> firstAtPosition;
+  std::vector<std::uint32_t> canonical(vertexCount);
+  std::vector<std::uint32_t> sharing(vertexCount, 0);
+
+  for(std::uint32_t v = 0; v < vertexCount; ++v) {
+    canonical[v] = firstAtPosition.try_emplace(position(positions, v), v).first->second;
+    ++sharing[canonical[v]];
+  }
+
+  std::vector<std::uint8_t> locked(vertexCount, 0);
+  for(std::uint32_t v = 0; v < vertexCount; ++v)
+    locked[v] = sharing[canonical[v]] > 1;
+
+  // an edge is on a border when no triangle walks it the other way
+  const auto edgeKey = [&](std::uint32_t a, std::uint32_t b) { return std::uint64_t(canonical[a]) << 32 | canonical[b]; };
+
+  std::unordered_map<std::uint64_t, std::uint32_t> edges;
+  edges.reserve(std::size(indices));
+  for(std::size_t t = 0; t < std::size(indices); t += 3)
+    for(int e = 0; e < 3; ++e)
+      ++edges[edgeKey(indices[t + e], indices[t + (e + 1) % 3])];
+
+  for(std::size_t t = 0; t < std::size(indices); t += 3) {
+    for(int e = 0; e < 3; ++e) {
+      const std::uint32_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+      if(!edges.contains(edgeKey(b, a)))
+        locked[a] = locked[b] = 1;
+    }
+  }
+
+  return locked;
+}
+
+// collapsing from onto to mustn't turn any surviving triangle around
+bool flips(std::span<const float> positions, std::span<const std::uint32_t> indices, std::span<const std::uint32_t> triangles, std::uint32_t from, std::uint32_t to) {
+  for(std::uint32_t t : triangles) {
+    std::array<std::uint32_t, 3> corners{indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+    if(std::ranges::find(corners, to) != std::end(corners)) // degenerates and goes away
+      continue;
+
+    const glm::vec3 before = glm::cross(position(positions, corners[1]) - position(positions, corners[0]), position(positions, corners[2]) - position(positions, corners[0]));
+    std::ranges::replace(corners, from, to);
+    const glm::vec3 after = glm::cross(position(positions, corners[1]) - position(positions, corners[0]), position(positions, corners[2]) - position(positions, corners[0]));
+
+    if(glm::dot(before, after) <= 0.0f)
+      return true;
+  }
+
+  return false;
+}
+
+}
+
+std::vector<std::uint32_t> simplifyMesh(std::span<const float> positions, std::span<const std::uint32_t> indices, std::size_t targetIndexCount, float maxError,
+                                        float& resultError) {
+  const std::size_t vertexCount = std::size(positions) / 3;
+
+  std::vector<std::uint32_t> result(std::begin(indices), std::end(indices));
+  resultError = 0.0f;
+
+  const std::vector<std::uint8_t> locked = lockedVertices(positions, indices);
+
+  std::vector<quadric_t> quadrics(vertexCount);
+  for(std::size_t t = 0; t < std::size(indices); t += 3) {
+    const glm::vec3 p0 = position(positions, indices[t]), p1 = position(positions, indices[t + 1]), p2 = position(positions, indices[t + 2]);
+
+    const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const float area = glm::length(normal);
+    if(area == 0.0f)
+      continue;
+
+    const glm::vec3 n = normal / area;
+    const quadric_t q = planeQuadric(n, -glm::dot(n, p0), 0.5 * area);
+    for(int c = 0; c < 3; ++c)
+      quadrics[indices[t + c]] += q;
+  }
+
+  const double maxCost = double(maxError) * maxError;
+
+  std::vector<collapse_t> collapses;
+  std::vector<std::uint32_t> remap(vertexCount);
+  std::vector<std::uint8_t> touched(vertexCount);
+  std::vector<std::uint32_t> triangleOffsets(vertexCount + 1);
+  std::vector<std::uint32_t> vertexTriangles;
+
+  while(std::size(result) > targetIndexCount) {
+    // triangles around each vertex, for the flip test
+    std::ranges::fill(triangleOffsets, 0);
+    for(std::uint32_t v : result)
+      ++triangleOffsets[v + 1];
+    for(std::size_t v = 0; v < vertexCount; ++v)
+      triangleOffsets[v + 1] += triangleOffsets[v];
+
+    vertexTriangles.resize(std::size(result));
+    std::vector<std::uint32_t> fill(std::begin(triangleOffsets), std::end(triangleOffsets) - 1);
+    for(std::size_t i = 0; i < std::size(result); ++i)
+      vertexTriangles[fill[result[i]]++] = static_cast<std::uint32_t>(i / 3);
+
+    collapses.clear();
+    for(std::size_t t = 0; t < std::size(result); t += 3) {
+      for(int e = 0; e < 3; ++e) {
+        const std::uint32_t a = result[t + e], b = result[t + (e + 1) % 3];
+
+        for(auto [from, to] : {std::pair(a, b), std::pair(b, a)}) {
+          if(locked[from])
+            continue;
+
+          quadric_t q = quadrics[from];
+          q += quadrics[to];
+          collapses.push_back({from, to, static_cast<float>(q.error(position(positions, to)))});
+        }
+      }
+    }
+
+    std::ranges::sort(collapses, {}, &collapse_t::cost);
+
+    // each collapse removes about two triangles, vertices around one collapse sit out the rest of the pass
+    const std::size_t wanted = (std::size(result) - targetIndexCount) / 6 + 1;
+    std::size_t collapsed = 0;
+
+    std::iota(std::begin(remap), std::end(remap), 0u);
+    std::ranges::fill(touched, 0);
+
+    for(const collapse_t& collapse : collapses) {
+      if(collapse.cost > maxCost || collapsed == wanted)
+        break;
+
+      if(touched[collapse.from] || touched[collapse.to])
+        continue;
+
+      const std::span<const std::uint32_t> around(std::data(vertexTriangles) + triangleOffsets[collapse.from], triangleOffsets[collapse.from + 1] - triangleOffsets[collapse.from]);
+      if(flips(positions, result, around, collapse.from, collapse.to))
+        continue;
+
+      for(std::uint32_t t : around)
+        for(int c = 0; c < 3; ++c)
+          touched[result[3 * t + c]] = 1;
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      resultError = std::max(resultError, std::sqrt(collapse.cost));
+      ++collapsed;
+    }
+
+    if(collapsed == 0)
+      break;
+
+    std::size_t write = 0;
+    for(std::size_t t = 0; t < std::size(result); t += 3) {
+      const std::uint32_t a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+      if(a == b || b == c || c == a)
+        continue;
+
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  return result;
+}
+
+lod_chain_t buildLodChain(std::span<const float> positions, std::span<const std::uint32_t> indices) {
+  lod_chain_t chain;
+
+  if(std::size(indices) / 3 < lodMinimumTriangles)
+    return chain;
+
+  glm::vec3 min{positions[0], positions[1], positions[2]}, max = min;
+  for(std::size_t i = 0; i + 2 < std::size(positions); i += 3) {
+    min = glm::min(min, glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+    max = glm::max(max, glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+  }
+  const float extent = glm::length(max - min);
+
+  std::span<const std::uint32_t> source = indices;
+  float error = 0.0f;
+
+  for(std::size_t level = 1; level <= lodMaxLevels; ++level) {
+    const std::size_t target = std::size(source) / 2 / 3 * 3;
+
+    float levelError = 0.0f;
+    std::vector<std::uint32_t> simplified = simplifyMesh(positions, source, target, extent * lodMaxRelativeError, levelError);
+
+    if(std::size(simplified) > std::size(source) * 3 / 4) // stalled on locked vertices or the error limit
+      break;
+
+    error += levelError; // each level is simplified from the previous one, so errors add up
+    chain.push_back({std::move(simplified), error});
+    source = chain.back().indices;
+  }
+
+  return chain;
+}
+
+int selectLod(std::span<const lod_range_t> levels, int current, float pixelsPerUnit, float thresholdPixels) {
+  constexpr float hysteresis = 1.25f;
+
+  const int levelCount = static_cast<int>(std::size(levels));
+  const auto pixels = [&](int level) { return levels[level].error * pixelsPerUnit; };
+
+  current = std::clamp(current, 0, levelCount - 1);
+
+  int level = 0;
+  while(level + 1 < levelCount && pixels(level + 1) <= thresholdPixels)
+    ++level;
+
+  if(level > current) { // coarser only once it's clearly good enough
+    while(level > current && pixels(level) > thresholdPixels / hysteresis)
+      --level;
+  } else if(level < current && pixels(current) <= thresholdPixels * hysteresis) { // finer only once the current one is clearly too coarse
+    level = current;
+  }
+
+  return level;
+}
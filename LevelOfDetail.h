@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// One simplified index buffer of a triangle primitive, drawn with the primitive's unchanged vertices
+struct lod_level_t {
+  std::vector<std::uint32_t> indices;
+  float error; // mesh space distance the surface may have moved, relative to the full detail mesh
+};
+
+// Coarser and coarser levels, the full detail indices (level 0) aren't part of it. Empty for primitives too small to bother.
+using lod_chain_t = std::vector<lod_level_t>;
+
+// Quadric error edge collapse (Garland and Heckbert) onto existing vertices, so the vertex buffer stays shared.
+// Vertices on open borders and on attribute seams are locked. Stops at targetIndexCount or when the next collapse would exceed maxError.
+std::vector<std::uint32_t> simplifyMesh(std::span<const float> positions, std::span<const std::uint32_t> indices, std::size_t targetIndexCount, float maxError,
+                                        float& resultError);
+
+// Halves the triangle count per level until simplification stalls
+lod_chain_t buildLodChain(std::span<const float> positions, std::span<const std::uint32_t> indices);
+
+// A level as uploaded: a range of the primitive's element buffer or arena indices, level 0 is the full detail mesh
+struct lod_range_t {
+  std::uint32_t firstIndex;
+  std::uint32_t indexCount;
+  float error; // lod_level_t::error, 0 for level 0
+};
+
+// Level to draw given how many pixels one mesh space unit covers at the node's distance.
+// Picks the coarsest level whose error stays under thresholdPixels. The current level is kept while it's within the hysteresis band around it,
+// so nodes near a boundary don't flip every frame.
+int selectLod(std::span<const lod_range_t> levels, int current, float pixelsPerUnit, float thresholdPixels);
@@ -0,0 +1,62 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <print>
+#include <utility>
+
+#include "MappedFile.h"
+
+namespace util {
+
+MappedFile::MappedFile(const std::filesystem::path& file) {
+  const int fd = ::open(file.c_str(), O_RDONLY);
+  if(fd == -1) {
+    std::println("Error [MappedFile] {}: {}", file.string(), std::strerror(errno));
+    return;
+  }
+
+  size = std::filesystem::file_size(file);
+
+  if(size != 0) {
+    address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if(address == MAP_FAILED) {
+      std::println("Error [MappedFile] {}: {}", file.string(), std::strerror(errno));
+      address = nullptr;
+      size = 0;
+    } else {
+      ::madvise(address, size, MADV_SEQUENTIAL); // parsed and uploaded front to back
+    }
+  }
+
+  ::close(fd); // the mapping keeps its own reference
+}
+
+MappedFile::~MappedFile() {
+  unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : address(std::exchange(other.address, nullptr)), size(std::exchange(other.size, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if(this != &other) {
+    unmap();
+    address = std::exchange(other.address, nullptr);
+    size = std::exchange(other.size, 0);
+  }
+
+  return *this;
+}
+
+void MappedFile::unmap() {
+  if(address != nullptr)
+    ::munmap(address, size);
+
+  address = nullptr;
+  size = 0;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace util {
+
+// Read-only POSIX mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::filesystem::path& file);
+  ~MappedFile();
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool isMapped() const {
+    return address != nullptr;
+  }
+
+  std::span<const unsigned char> bytes() const {
+    return {static_cast<const unsigned char*>(address), size};
+  }
+
+  void unmap();
+
+private:
+  void* address = nullptr;
+  std::size_t size = 0;
+};
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// std430 layout of Material_t in material.glsl
+struct gpu_material_t {
+  glm::vec4 baseColorFactor = {1.0f, 1.0f, 1.0f, 1.0f}; // default
+  glm::vec3 emissiveFactor = {0.0f, 0.0f, 0.0f};       // default
+  float roughnessFactor = 1.0f;                        // default
+  float metallicFactor = 1.0f;                         // default
+  float normalScale = 1.0f;                            // default
+  float occlusionStrength = 1.0f;                      // default
+  std::uint32_t textureFlags = 0;                      // bit n is set when textures[n] is present, also the program variant
+};
+
+static_assert(sizeof(gpu_material_t) == 48);
+
+struct material_t {
+  enum class alphaMode_t { opaque, mask, blend };
+
+  // also the texture unit, the textureFlags bit and the index into textureDefines of the kind
+  enum class textureKind { baseColorTexture, metallicRoughnessTexture, normalTexture, occlusionTexture, emissionTexture, count };
+
+  gpu_material_t factors;
+
+  std::array<GLuint, std::to_underlying(textureKind::count)> textures{}; // 0 when absent
+  std::array<GLuint, std::to_underlying(textureKind::count)> samplers{}; // sampler objects bound next to textures
+
+  alphaMode_t alphaMode = alphaMode_t::opaque; // default
+  double alphaCutoff = 0.5;                    // default
+  bool doubleSided = false;                    // default
+
+  std::uint32_t textureSet = 0; // dense id of the texture and sampler combination, used for sorting draws
+
+  // shader feature enabled by each textureKind in the fragment shader variants
+  static inline const std::vector<std::string> textureDefines = {
+      "HAS_BASE_COLOR_TEXTURE", "HAS_METALLIC_ROUGHNESS_TEXTURE", "HAS_NORMAL_TEXTURE", "HAS_OCCLUSION_TEXTURE", "HAS_EMISSIVE_TEXTURE",
+  };
+};
@@ -0,0 +1,278 @@
+#include "MeshOptimizer.h"
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t forsythCacheSize = 32;
+constexpr float forsythDecayPower = 1.5f;
+constexpr float forsythLastTriangleScore = 0.75f;
+constexpr float forsythValenceBoostScale = 2.0f;
+constexpr float forsythValenceBoostPower = 0.5f;
+
+float forsythVertexScore(int cachePosition, std::uint32_t remainingTriangles) {
+  if(remainingTriangles == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if(cachePosition >= 0) {
+    if(cachePosition < 3) // used by the last triangle, whichever order it's emitted in
+      score = forsythLastTriangleScore;
+    else
+      score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (forsythCacheSize - 3), forsythDecayPower);
+  }
+
+  // vertices with few triangles left are finished off first, so they don't have to come back later
+  return score + forsythValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -forsythValenceBoostPower);
+}
+
+glm::vec3 position(std::span<const float> positions, std::uint32_t v) {
+  return {positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]};
+}
+
+template<std::size_t components>
+void remapStream(std::vector<float>& stream, std::span<const std::uint32_t> remap, std::size_t newVertexCount) {
+  if(std::empty(stream))
+    return;
+
+  std::vector<float> remapped(newVertexCount * components);
+  for(std::size_t v = 0; v < std::size(remap); ++v)
+    if(remap[v] != ~0u)
+      std::copy_n(std::data(stream) + v * components, components, std::data(remapped) + remap[v] * components);
+
+  stream = std::move(remapped);
+}
+
+}
+
+vertex_cache_stats_t analyzeVertexCache(std::span<const std::uint32_t> indices, std::size_t vertexCount, std::size_t cacheSize) {
+  vertex_cache_stats_t stats;
+  stats.triangles = std::size(indices) / 3;
+
+  std::vector<std::uint8_t> referenced(vertexCount, 0);
+  std::deque<std::uint32_t> cache;
+
+  for(std::uint32_t v : indices) {
+    referenced[v] = 1;
+
+    if(std::ranges::find(cache, v) != std::end(cache))
+      continue;
+
+    ++stats.misses;
+    cache.push_front(v);
+    if(std::size(cache) > cacheSize)
+      cache.pop_back();
+  }
+
+  stats.vertices = std::ranges::count(referenced, 1);
+  return stats;
+}
+
+void optimizeVertexCache(std::span<std::uint32_t> indices, std::size_t vertexCount) {
+  const std::size_t triangleCount = std::size(indices) / 3;
+  if(triangleCount == 0)
+    return;
+
+  // triangles around each vertex, the first remaining[v] of them aren't emitted yet
+  std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+  for(std::uint32_t v : indices)
+    ++offsets[v + 1];
+  std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+
+  std::vector<std::uint32_t> adjacency(std::size(indices));
+  std::vector<std::uint32_t> remaining(vertexCount, 0);
+  for(std::size_t i = 0; i < std::size(indices); ++i)
+    adjacency[offsets[indices[i]] + remaining[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+
+  std::vector<int> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for(std::size_t v = 0; v < vertexCount; ++v)
+    vertexScores[v] = forsythVertexScore(-1, remaining[v]);
+
+  std::vector<std::uint8_t> emitted(triangleCount, 0);
+  std::vector<std::uint32_t> result;
+  result.reserve(std::size(indices));
+
+  std::vector<std::uint32_t> cache, nextCache;
+  std::size_t nextInOrder = 0;
+  std::int64_t best = -1;
+
+  while(std::size(result) < std::size(indices)) {
+    if(best == -1) { // nothing next to the cache, carry on with the input order
+      while(emitted[nextInOrder])
+        ++nextInOrder;
+      best = static_cast<std::int64_t>(nextInOrder);
+    }
+
+    const std::array<std::uint32_t, 3> triangle{indices[3 * best], indices[3 * best + 1], indices[3 * best + 2]};
+    emitted[best] = 1;
+    result.insert(std::end(result), std::begin(triangle), std::end(triangle));
+
+    for(std::uint32_t v : triangle) {
+      const std::span<std::uint32_t> around(std::data(adjacency) + offsets[v], remaining[v]);
+      if(const auto it = std::ranges::find(around, static_cast<std::uint32_t>(best)); it != std::end(around)) {
+        std::iter_swap(it, std::prev(std::end(around)));
+        --remaining[v];
+      }
+    }
+
+    nextCache.assign(std::begin(triangle), std::end(triangle));
+    for(std::uint32_t v : cache)
+      if(std::ranges::find(triangle, v) == std::end(triangle))
+        nextCache.push_back(v);
+
+    for(std::size_t i = 0; i < std::size(nextCache); ++i) {
+      const std::uint32_t v = nextCache[i];
+      cachePositions[v] = i < forsythCacheSize ? static_cast<int>(i) : -1;
+      vertexScores[v] = forsythVertexScore(cachePositions[v], remaining[v]);
+    }
+
+    nextCache.resize(std::min(std::size(nextCache), forsythCacheSize));
+    std::swap(cache, nextCache);
+
+    best = -1;
+    float bestScore = -1.0f;
+    for(std::uint32_t v : cache) {
+      for(std::uint32_t t : std::span(std::data(adjacency) + offsets[v], remaining[v])) {
+        const float score = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+        if(score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+  }
+
+  std::ranges::copy(result, std::begin(indices));
+}
+
+void optimizeOverdraw(std::span<std::uint32_t> indices, std::span<const float> positions, float threshold) {
+  constexpr std::size_t clusterCacheSize = 16;
+  constexpr std::size_t minimumClusterTriangles = 16;
+
+  const std::size_t triangleCount = std::size(indices) / 3;
+  const std::size_t vertexCount = std::size(positions) / 3;
+  if(triangleCount < 2 * minimumClusterTriangles)
+    return;
+
+  const float meshAcmr = analyzeVertexCache(indices, vertexCount, clusterCacheSize).acmr();
+
+  // a cluster ends where the cache simulation restarts (all three vertices missed) or where cutting keeps its ACMR within threshold
+  std::vector<std::size_t> clusterStarts{0};
+  {
+    std::deque<std::uint32_t> cache;
+    std::size_t clusterMisses = 0;
+
+    for(std::size_t t = 0; t < triangleCount; ++t) {
+      int misses = 0;
+      for(int c = 0; c < 3; ++c) {
+        const std::uint32_t v = indices[3 * t + c];
+        if(std::ranges::find(cache, v) != std::end(cache))
+          continue;
+
+        ++misses;
+        cache.push_front(v);
+        if(std::size(cache) > clusterCacheSize)
+          cache.pop_back();
+      }
+
+      const std::size_t clusterTriangles = t - clusterStarts.back();
+      const bool hardBoundary = misses == 3;
+      const bool softBoundary = clusterTriangles >= minimumClusterTriangles && static_cast<float>(clusterMisses) / clusterTriangles <= meshAcmr * threshold;
+
+      if(clusterTriangles >= minimumClusterTriangles && (hardBoundary || softBoundary)) {
+        clusterStarts.push_back(t);
+        clusterMisses = 0;
+        cache.clear();
+        for(int c = 0; c < 3; ++c)
+          cache.push_front(indices[3 * t + c]);
+        misses = 3;
+      }
+
+      clusterMisses += misses;
+    }
+  }
+
+  const std::size_t clusterCount = std::size(clusterStarts);
+  clusterStarts.push_back(triangleCount);
+
+  glm::vec3 meshCentroid(0.0f);
+  for(std::size_t v = 0; v < vertexCount; ++v)
+    meshCentroid += position(positions, v);
+  meshCentroid /= static_cast<float>(vertexCount);
+
+  // outward facing clusters, as seen from the mesh centroid, are the likely occluders
+  std::vector<float> sortKeys(clusterCount);
+  for(std::size_t c = 0; c < clusterCount; ++c) {
+    glm::vec3 centroid(0.0f), normal(0.0f);
+    float area = 0.0f;
+
+    for(std::size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+      const glm::vec3 p0 = position(positions, indices[3 * t]), p1 = position(positions, indices[3 * t + 1]), p2 = position(positions, indices[3 * t + 2]);
+      const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+      const float a = glm::length(n);
+
+      centroid += (p0 + p1 + p2) * (a / 3.0f);
+      normal += n;
+      area += a;
+    }
+
+    const float normalLength = glm::length(normal);
+    sortKeys[c] = area > 0.0f && normalLength > 0.0f ? glm::dot(centroid / area - meshCentroid, normal / normalLength) : 0.0f;
+  }
+
+  std::vector<std::size_t> order(clusterCount);
+  std::iota(std::begin(order), std::end(order), 0);
+  std::ranges::stable_sort(order, std::ranges::greater{}, [&](std::size_t c) { return sortKeys[c]; });
+
+  std::vector<std::uint32_t> result;
+  result.reserve(std::size(indices));
+  for(std::size_t c : order)
+    result.insert(std::end(result), std::begin(indices) + 3 * clusterStarts[c], std::begin(indices) + 3 * clusterStarts[c + 1]);
+
+  std::ranges::copy(result, std::begin(indices));
+}
+
+std::size_t optimizeVertexFetchRemap(std::span<std::uint32_t> indices, std::size_t vertexCount, std::vector<std::uint32_t>& remap) {
+  remap.assign(vertexCount, ~0u);
+
+  std::uint32_t next = 0;
+  for(std::uint32_t& v : indices) {
+    if(remap[v] == ~0u)
+      remap[v] = next++;
+    v = remap[v];
+  }
+
+  return next;
+}
+
+mesh_optimization_stats_t optimizeMesh(vertex_streams_t& streams) {
+  const std::size_t vertexCount = streams.vertexCount();
+
+  mesh_optimization_stats_t stats;
+  stats.before = analyzeVertexCache(streams.indices, vertexCount);
+
+  optimizeVertexCache(streams.indices, vertexCount);
+  optimizeOverdraw(streams.indices, streams.positions);
+
+  std::vector<std::uint32_t> remap;
+  const std::size_t newVertexCount = optimizeVertexFetchRemap(streams.indices, vertexCount, remap);
+
+  remapStream<3>(streams.positions, remap, newVertexCount);
+  remapStream<3>(streams.normals, remap, newVertexCount);
+  remapStream<4>(streams.tangents, remap, newVertexCount);
+  remapStream<2>(streams.texcoords, remap, newVertexCount);
+
+  stats.after = analyzeVertexCache(streams.indices, newVertexCount);
+  return stats;
+}
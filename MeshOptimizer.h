@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "GeometryArena.h"
+
+// Post-transform vertex cache behaviour of an index buffer, simulated with a FIFO cache
+struct vertex_cache_stats_t {
+  std::size_t triangles = 0;
+  std::size_t vertices = 0;
+  std::size_t misses = 0;
+
+  float acmr() const { // average cache misses per triangle, 0.5 is the ideal for a regular grid, 3 the worst
+    return triangles != 0 ? static_cast<float>(misses) / triangles : 0.0f;
+  }
+
+  float atvr() const { // average transforms per vertex, 1 is the ideal
+    return vertices != 0 ? static_cast<float>(misses) / vertices : 0.0f;
+  }
+
+  vertex_cache_stats_t& operator+=(const vertex_cache_stats_t& stats) {
+    triangles += stats.triangles;
+    vertices += stats.vertices;
+    misses += stats.misses;
+    return *this;
+  }
+};
+
+vertex_cache_stats_t analyzeVertexCache(std::span<const std::uint32_t> indices, std::size_t vertexCount, std::size_t cacheSize = 16);
+
+// Forsyth's linear speed triangle reordering for vertex cache locality
+void optimizeVertexCache(std::span<std::uint32_t> indices, std::size_t vertexCount);
+
+// Splits the cache ordered triangles into clusters and draws outward facing clusters first, so they occlude the rest.
+// Only cuts where the cache efficiency stays within threshold of the input's.
+void optimizeOverdraw(std::span<std::uint32_t> indices, std::span<const float> positions, float threshold = 1.05f);
+
+// Renumbers vertices in first use order and drops the unreferenced ones, remap is old to new vertex, ~0u for dropped ones. Returns the new vertex count.
+std::size_t optimizeVertexFetchRemap(std::span<std::uint32_t> indices, std::size_t vertexCount, std::vector<std::uint32_t>& remap);
+
+struct mesh_optimization_stats_t {
+  vertex_cache_stats_t before;
+  vertex_cache_stats_t after;
+};
+
+// All of the above on one primitive's streams, in that order
+mesh_optimization_stats_t optimizeMesh(vertex_streams_t& streams);
@@ -1,23 +1,46 @@
 #pragma once
 
+#include "Bounds.h"
 #include "Camera.h"
+#include "GeometryArena.h"
+#include "LevelOfDetail.h"
 
 #include <GL/glew.h>
-#include <glm/ext/matrix_float4x4.hpp>
-#include <glm/vec3.hpp>
-#include <glm/vec4.hpp>
 
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
 #include <optional>
 #include <array>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// A primitive's morph target deltas in Scene::morphDeltas. Attribute a of target t starts at firstDelta + (t * attribute count + a) * vertexCount,
+// the present attributes in POSITION, NORMAL, TANGENT order.
+struct morph_targets_t {
+  std::uint32_t firstDelta = 0;
+  std::uint32_t targetCount = 0;
+  std::uint32_t vertexCount = 0;
+  std::uint32_t attributes = 0; // positionStream, normalStream and tangentStream bits
+};
 
-struct mesh_buffer_t {
+// std430 layout of MorphWeight_t in vertexShader.vert
+struct morph_weight_t {
+  std::uint32_t target;
+  float weight;
+};
+
+struct primitive_buffer_t {
   GLuint vertexArrayID = -1;
 
-  struct vertexAttributeBuffer_t {
+  struct vertexAttributeBuffer_t { // mostly Scene's shared buffer view buffers, bound at the accessor's offset
     GLuint positionBufferID = -1;
     GLuint normalBufferID = -1;
     GLuint tangentBufferID = -1;
+    std::unordered_map<std::string, GLuint> textureCoordinateBufferIDs; // TEXCOORD_n
+    GLuint jointsBufferID = -1;
+    GLuint weightsBufferID = -1;
   } vertexAttribute;
 
   size_t count;
@@ -30,62 +53,50 @@ struct mesh_buffer_t {
     size_t offset;
   } element;
 
-  struct material_properties_t {
-    enum class alphaMode_t { opaque, mask, blend };
-
-    enum class textureKind { normalTexture, occlusionTexture, emissionTexture, baseColorTexture, metallicRoughnessTexture };
-
-    alphaMode_t alphaMode = alphaMode_t::opaque; // default
-    double alphaCutoff = 0.5;                    // default
-    bool doubleSided = false;                    // default
-
-    glm::vec3 emissiveFactor = {0.0f, 0.0f, 0.0f}; // default
-
-    struct pbrMetallicRoughness_t {
-      glm::vec4 baseColorFactor = {1.0, 1.0, 1.0, 1.0}; // default
-      float roughnessFactor = 1.0;                      // default
-      float metallicFactor = 1.0;                       // default
+  arena_range_t arenaRange; // arena == -1 unless the primitive lives in a shared geometry arena
 
-      struct baseColorTexture_t {
-        GLuint textureID = -1;
-      } baseColorTexture;
+  std::uint32_t vertexFormat = 0;     // vertexStream_t bits when uploaded from vertex streams, 0 for the exported accessors
+  vertex_quantization_t quantization; // of the mesh, when vertexFormat has quantizedStreams
 
-      struct metallicRoughnessTexture_t {
-        GLuint textureID = -1;
-      } metallicRoughnessTexture;
+  std::vector<lod_range_t> lods; // full detail first, into the element buffer or the arena indices, empty without a LOD chain
 
-    } pbr;
+  morph_targets_t morphTargets;
 
-    struct normalTexture_t {
-      float scale = 1.0; // default;
-      GLuint textureID = -1;
-    } normalTexture;
-
-    struct occlusionTexture_t {
-      float strength = 1.0; // default
-      GLuint textureID = -1;
-    } occlusionTexture;
+  int materialIndex; // into Scene::materials
+};
 
-    struct emissiveTexture_t {
-      GLuint textureID = -1;
-    } emissiveTexture;
+// GL resources of one glTF mesh, shared by every node that references it
+struct mesh_buffer_t {
+  std::vector<primitive_buffer_t> primitives;
+  aabb_t bounds; // of the POSITION accessors
+};
 
-    std::unordered_map<std::string, GLuint> textureUV;
+// EXT_mesh_gpu_instancing accessors of a glTF node, -1 when absent
+struct gpu_instancing_t {
+  int translation = -1;
+  int rotation = -1;
+  int scale = -1;
 
-  } material;
+  bool empty() const {
+    return translation == -1 && rotation == -1 && scale == -1;
+  }
 };
 
 struct node_t {
-  enum class type_t { mesh, camera, skin };
-  type_t type;
+  enum class type_t { none, mesh, camera, skin };
+  type_t type = type_t::none;
 
-  mesh_buffer_t mesh_buffer;
+  int mesh = -1;                      // into Scene::meshes
+  int skin = -1;                      // into Scene::skins, its joints place the mesh in world space instead of the node
+  std::vector<int> lods;              // per primitive of the mesh, the level drawn last frame
+  std::vector<glm::mat4x4> instances; // EXT_mesh_gpu_instancing transforms relative to the node, empty for a single instance
 
-  std::optional<Camera> camera;
-
-  glm::mat4x4 transformMatrix() const {
-    return transformMatrix_;
-  }
+  struct morph_weights_t {
+    std::uint32_t first = 0;       // into Scene::morphWeights
+    std::uint32_t count = 0;       // the mesh's target count, 0 without morph targets
+    std::uint32_t firstActive = 0; // into Scene::activeMorphWeights, the non-zero ones
+    std::uint32_t activeCount = 0;
+  } morph;
 
-  glm::mat4x4 transformMatrix_ = glm::mat4x4(1.0f);
+  std::optional<Camera> camera;
 };
@@ -0,0 +1,218 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+float Profiler::scope_stats_t::percentile(float p) const {
+  if(std::empty(samples))
+    return 0.0f;
+
+  std::vector<float> sorted = samples;
+  const std::size_t n = std::min(std::size(sorted) - 1, static_cast<std::size_t>(std::lround(p * (std::size(sorted) - 1))));
+  std::ranges::nth_element(sorted, std::begin(sorted) + n);
+
+  return sorted[n];
+}
+
+float Profiler::scope_stats_t::last() const {
+  if(std::empty(samples))
+    return 0.0f;
+
+  return samples[(next + std::size(samples) - 1) % std::size(samples)];
+}
+
+Profiler::cpu_scope_t::cpu_scope_t(Profiler& profiler, const char* name) : profiler(profiler) {
+  profiler.beginCpu(name);
+}
+
+Profiler::cpu_scope_t::~cpu_scope_t() {
+  profiler.endCpu();
+}
+
+Profiler::gpu_scope_t::gpu_scope_t(Profiler& profiler, const char* name) : profiler(profiler) {
+  profiler.beginCpu(name);
+  profiler.beginGpu(name);
+}
+
+Profiler::gpu_scope_t::~gpu_scope_t() {
+  profiler.endGpu();
+  profiler.endCpu();
+}
+
+double Profiler::microseconds(clock::time_point time) const {
+  return std::chrono::duration<double, std::micro>(time - start).count();
+}
+
+void Profiler::beginFrame() {
+  assert(std::empty(openScopes));
+
+  gpu_frame_t& frame = gpuFrames[frameIndex % gpuLatency];
+  readGpuFrame(frame);
+  frame.begin = microseconds(clock::now());
+
+  beginCpu("frame");
+}
+
+void Profiler::endFrame() {
+  endCpu(); // frame
+  assert(std::empty(openScopes) && !gpuScopeOpen);
+
+  addSamples();
+
+  if(captureFrames != 0) {
+    captured.insert(std::end(captured), std::begin(frameEvents), std::end(frameEvents));
+    if(--captureFrames == 0)
+      writeTrace();
+  }
+
+  frameEvents.clear();
+  ++frameIndex;
+}
+
+void Profiler::beginCpu(const char* name) {
+  openScopes.push_back({name, clock::now()});
+}
+
+void Profiler::endCpu() {
+  assert(!std::empty(openScopes));
+
+  const open_scope_t scope = openScopes.back();
+  openScopes.pop_back();
+
+  const double begin = microseconds(scope.begin);
+  frameEvents.push_back({scope.name, track_t::cpu, begin, microseconds(clock::now()) - begin});
+}
+
+void Profiler::beginGpu(const char* name) {
+  assert(!gpuScopeOpen);
+
+  gpu_frame_t& frame = gpuFrames[frameIndex % gpuLatency];
+  if(frame.used == std::size(frame.queries)) {
+    GLuint id;
+    glCreateQueries(GL_TIME_ELAPSED, 1, &id);
+    frame.queries.push_back({name, id});
+  }
+
+  gpu_query_t& query = frame.queries[frame.used++];
+  query.name = name;
+
+  glBeginQuery(GL_TIME_ELAPSED, query.id);
+  gpuScopeOpen = true;
+}
+
+void Profiler::endGpu() {
+  assert(gpuScopeOpen);
+
+  glEndQuery(GL_TIME_ELAPSED);
+  gpuScopeOpen = false;
+}
+
+// the scopes are laid out back to back from the frame's CPU start, an approximation for the trace
+void Profiler::readGpuFrame(gpu_frame_t& frame) {
+  double begin = frame.begin;
+
+  for(std::size_t i = 0; i < frame.used; ++i) {
+    gpu_query_t& query = frame.queries[i];
+
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if(!available) { // still in flight after gpuLatency frames, drop the sample and start over with a fresh query
+      glDeleteQueries(1, &query.id);
+      glCreateQueries(GL_TIME_ELAPSED, 1, &query.id);
+      continue;
+    }
+
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds);
+
+    const double duration = nanoseconds / 1000.0;
+    frameEvents.push_back({query.name, track_t::gpu, begin, duration});
+    begin += duration;
+  }
+
+  frame.used = 0;
+}
+
+void Profiler::addSamples() {
+  const std::size_t firstNew = std::size(stats);
+  std::vector<float> totals(std::size(stats), -1.0f); // -1 for scopes that didn't run this frame
+
+  for(const event_t& event : frameEvents) {
+    auto it = std::ranges::find_if(stats, [&](const scope_stats_t& s) { return s.track == event.track && s.name == event.name; });
+    if(it == std::end(stats)) {
+      stats.push_back({event.name, event.track});
+      totals.push_back(-1.0f);
+      it = std::prev(std::end(stats));
+    }
+
+    float& total = totals[std::distance(std::begin(stats), it)];
+    total = std::max(total, 0.0f) + static_cast<float>(event.duration / 1000.0);
+  }
+
+  for(std::size_t i = 0; i < std::size(stats); ++i) {
+    if(totals[i] < 0.0f)
+      continue;
+
+    scope_stats_t& scope = stats[i];
+    if(std::size(scope.samples) < historySize)
+      scope.samples.push_back(totals[i]);
+    else
+      scope.samples[scope.next] = totals[i];
+    scope.next = (scope.next + 1) % historySize;
+  }
+
+  // new scopes sorted in by track and name, so the panel keeps its order
+  if(firstNew != std::size(stats))
+    std::ranges::sort(stats, {}, [](const scope_stats_t& s) { return std::pair(s.track, s.name); });
+}
+
+void Profiler::capture(std::size_t frames, const std::filesystem::path& traceFile) {
+  this->traceFile = traceFile;
+  captureFrames = frames;
+  captured.clear();
+}
+
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU, complete events on a CPU and a GPU thread
+void Profiler::writeTrace() const {
+  std::ofstream out(traceFile, std::ios::trunc);
+  if(!out) {
+    std::println("Error [Profiler] can't write {}", traceFile.string());
+    return;
+  }
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+  out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+  for(const event_t& event : captured) {
+    const int tid = event.track == track_t::gpu;
+    out << std::format(",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":0,\"tid\":{}}}", event.name, tid ? "gpu" : "cpu", event.begin,
+                       event.duration, tid);
+  }
+
+  out << "\n]}\n";
+
+  std::println("-- Wrote {} trace events to {}", std::size(captured), traceFile.string());
+}
+
+void Profiler::unload() {
+  for(gpu_frame_t& frame : gpuFrames) {
+    for(const gpu_query_t& query : frame.queries)
+      glDeleteQueries(1, &query.id);
+    frame = {};
+  }
+  gpuScopeOpen = false;
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace util {
+
+// Frame profiler for the render thread. CPU scopes are timed with steady_clock, GPU scopes with GL_TIME_ELAPSED queries
+// from a ring of gpuLatency frames: a frame's queries are read when its slot comes around again and only if their result is available,
+// so the CPU never waits on the GPU. GPU scopes can't nest, GL has one time elapsed query active at a time.
+struct Profiler {
+  static constexpr std::size_t historySize = 256; // samples per scope
+  static constexpr std::size_t gpuLatency = 4;    // frames in the query ring
+
+  enum class track_t : std::uint8_t { cpu, gpu };
+
+  // milliseconds per frame the scope ran in, summed when it ran more than once
+  struct scope_stats_t {
+    std::string_view name;
+    track_t track;
+
+    std::vector<float> samples; // ring, the oldest at next once full
+    std::size_t next = 0;
+
+    float percentile(float p) const; // p in [0, 1]
+    float last() const;
+  };
+
+  struct cpu_scope_t {
+    cpu_scope_t(Profiler& profiler, const char* name);
+    ~cpu_scope_t();
+
+    Profiler& profiler;
+  };
+
+  struct gpu_scope_t { // times the CPU side too
+    gpu_scope_t(Profiler& profiler, const char* name);
+    ~gpu_scope_t();
+
+    Profiler& profiler;
+  };
+
+  void beginFrame();
+  void endFrame();
+
+  void beginCpu(const char* name); // names are string literals, they're kept as pointers
+  void endCpu();
+  void beginGpu(const char* name);
+  void endGpu();
+
+  void capture(std::size_t frames, const std::filesystem::path& traceFile); // Chrome trace JSON written after the last frame
+  bool capturing() const {
+    return captureFrames != 0;
+  }
+
+  const std::vector<scope_stats_t>& scopes() const {
+    return stats;
+  }
+
+  void unload(); // GL queries
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  // Chrome trace complete event, microseconds since the profiler started
+  struct event_t {
+    const char* name;
+    track_t track;
+    double begin;
+    double duration;
+  };
+
+  struct open_scope_t {
+    const char* name;
+    clock::time_point begin;
+  };
+
+  struct gpu_query_t {
+    const char* name;
+    GLuint id;
+  };
+
+  struct gpu_frame_t {
+    double begin = 0.0; // CPU time the frame started, TIME_ELAPSED has durations only
+    std::vector<gpu_query_t> queries;
+    std::size_t used = 0;
+  };
+
+  clock::time_point start = clock::now();
+  std::uint64_t frameIndex = 0;
+
+  std::vector<open_scope_t> openScopes;
+  std::vector<event_t> frameEvents; // ended this frame, GPU ones are from gpuLatency frames ago
+
+  std::array<gpu_frame_t, gpuLatency> gpuFrames;
+  bool gpuScopeOpen = false;
+
+  std::vector<scope_stats_t> stats;
+
+  std::size_t captureFrames = 0; // left to capture
+  std::filesystem::path traceFile;
+  std::vector<event_t> captured;
+
+  double microseconds(clock::time_point time) const;
+  void readGpuFrame(gpu_frame_t& frame); // results that are available, never waits
+  void addSamples();
+  void writeTrace() const;
+};
+
+}
@@ -0,0 +1,50 @@
+#include "ProgramVariants.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace util {
+
+ProgramVariants& ProgramVariants::setCacheDirectory(const std::filesystem::path& directory) {
+  cacheDirectory = directory;
+  return *this;
+}
+
+ProgramVariants& ProgramVariants::setSources(const std::vector<std::filesystem::path>& shaderFiles, const std::vector<std::string>& features,
+                                             const std::vector<std::string>& defines) {
+  unload();
+
+  this->shaderFiles = shaderFiles;
+  this->features = features;
+  this->defines = defines;
+
+  return *this;
+}
+
+GLuint ProgramVariants::get(std::uint32_t featureMask) {
+  if(auto found = programs.find(featureMask); found != std::end(programs))
+    return found->second.getProgramID();
+
+  std::vector<std::string> variantDefines = defines;
+  for(std::size_t i = 0; i < std::size(features); ++i)
+    if(featureMask & (1u << i))
+      variantDefines.push_back(features[i]);
+
+  ShaderLoader& loader = programs[featureMask];
+  if(!cacheDirectory.empty())
+    loader.setCacheDirectory(cacheDirectory);
+
+  return loader.load(shaderFiles, variantDefines).compile().attach().link().getProgramID();
+}
+
+void ProgramVariants::unload() {
+  for(auto& [_, loader] : programs)
+    loader.unload();
+  programs.clear();
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderLoader.h"
+
+namespace util {
+
+// Programs built from the same sources, specialized on a feature mask: bit n of the mask #defines features[n].
+// A variant is compiled the first time it's asked for and kept until unload.
+struct ProgramVariants {
+  ProgramVariants& setCacheDirectory(const std::filesystem::path& directory);
+  ProgramVariants& setSources(const std::vector<std::filesystem::path>& shaderFiles, const std::vector<std::string>& features, const std::vector<std::string>& defines = {});
+
+  GLuint get(std::uint32_t featureMask);
+  void unload();
+
+  std::size_t size() const {
+    return std::size(programs);
+  }
+
+private:
+  std::filesystem::path cacheDirectory;
+
+  std::vector<std::filesystem::path> shaderFiles;
+  std::vector<std::string> features;
+  std::vector<std::string> defines; // in every variant
+
+  std::unordered_map<std::uint32_t, ShaderLoader> programs;
+};
+
+}
@@ -0,0 +1,51 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+std::uint64_t makeDrawKey(std::uint32_t program, bool cullFace, std::uint32_t textureSet, std::uint32_t vertexArray, std::uint32_t material, float depth) {
+  // positive floats sort like their bit patterns, the upper half keeps enough precision to order draws front to back
+  const std::uint64_t depthBits = std::bit_cast<std::uint32_t>(std::max(depth, 0.0f)) >> 16;
+
+  // clang-format off
+  return (std::uint64_t(program     & 0x1F)   << 59) |
+         (std::uint64_t(cullFace)             << 58) |
+         (std::uint64_t(textureSet  & 0x1FFF) << 45) |
+         (std::uint64_t(vertexArray & 0x7FFF) << 30) |
+         (std::uint64_t(material    & 0x3FFF) << 16) |
+         depthBits;
+  // clang-format on
+}
+
+void RenderQueue::clear() {
+  queue.clear();
+}
+
+void RenderQueue::push(std::uint64_t key, int node, int primitive) {
+  queue.push_back({key, node, primitive});
+}
+
+void RenderQueue::sort() {
+  scratch.resize(std::size(queue));
+
+  for(int shift = 0; shift < 64; shift += 8) {
+    std::array<std::size_t, 256> offsets{};
+
+    for(const draw_item_t& item : queue)
+      ++offsets[(item.key >> shift) & 0xFF];
+
+    if(std::ranges::find(offsets, std::size(queue)) != std::end(offsets)) // every key has the same byte here
+      continue;
+
+    for(std::size_t sum = 0; std::size_t& offset : offsets)
+      sum += std::exchange(offset, sum);
+
+    for(const draw_item_t& item : queue)
+      scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+
+    std::swap(queue, scratch);
+  }
+}
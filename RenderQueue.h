@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Draw key layout, most significant bits first, so sorting groups draws by the most expensive state change:
+// | program 5 | cull face 1 | texture set 13 | vertex array 15 | material 14 | depth 16 |
+// Materials are indices into the material SSBO, switching them costs no GL call
+std::uint64_t makeDrawKey(std::uint32_t program, bool cullFace, std::uint32_t textureSet, std::uint32_t vertexArray, std::uint32_t material, float depth);
+
+struct draw_item_t {
+  std::uint64_t key;
+  int node;      // scene node slot
+  int primitive; // into the primitives of the node's mesh
+};
+
+struct RenderQueue {
+  void clear();
+  void push(std::uint64_t key, int node, int primitive);
+
+  // LSD radix sort on the keys, passes over bytes every key shares are skipped
+  void sort();
+
+  std::span<const draw_item_t> items() const {
+    return queue;
+  }
+
+private:
+  std::vector<draw_item_t> queue;
+  std::vector<draw_item_t> scratch;
+};
@@ -0,0 +1,39 @@
+#include <GL/glew.h>
+
+#include <array>
+#include <cassert>
+
+#include "SamplerCache.h"
+
+GLuint SamplerCache::get(int minFilter, int magFilter, int wrapS, int wrapT) {
+  // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#texture-data, filters are up to the implementation when undefined
+  if(minFilter == -1)
+    minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  if(magFilter == -1)
+    magFilter = GL_LINEAR;
+
+  const std::array<int, 4> key = {minFilter, magFilter, wrapS, wrapT};
+
+  if(const auto it = samplers.find(key); it != std::end(samplers))
+    return it->second;
+
+  GLuint id;
+  glCreateSamplers(1, &id);
+
+  glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, minFilter);
+  glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, magFilter);
+  glSamplerParameteri(id, GL_TEXTURE_WRAP_S, wrapS);
+  glSamplerParameteri(id, GL_TEXTURE_WRAP_T, wrapT);
+
+  assert(glGetError() == GL_NO_ERROR);
+
+  samplers[key] = id;
+  return id;
+}
+
+void SamplerCache::clear() {
+  for(const auto& [_, id] : samplers)
+    glDeleteSamplers(1, &id);
+
+  samplers.clear();
+}
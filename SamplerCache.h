@@ -0,0 +1,17 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <map>
+
+// GL sampler objects shared by every texture with the same glTF sampler state
+struct SamplerCache {
+  // glTF filter and wrap values, -1 filters select the defaults
+  GLuint get(int minFilter, int magFilter, int wrapS, int wrapT);
+
+  void clear();
+
+private:
+  std::map<std::array<int, 4>, GLuint> samplers;
+};
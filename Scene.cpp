@@ -4,33 +4,165 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/string_cast.hpp>
 
 #include <tiny_gltf.h>
 
+#include <atomic>
 #include <filesystem>
+#include <cstring>
+#include <stop_token>
+#include <thread>
 #include <span>
 #include <cmath>
 #include <vector>
+#include <map>
 #include <print>
 #include <utility>
 #include <algorithm>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <ranges>
 
 #include "Scene.h"
+#include "Accessor.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
+#include "SceneCache.h"
+
+void Scene::setThreadPool(util::ThreadPool* threadPool) {
+  this->threadPool = threadPool;
+}
+
+namespace {
+
+// https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout, empty if there's no BIN chunk
+std::span<const unsigned char> glbBinaryChunk(std::span<const unsigned char> glb) {
+  constexpr std::uint32_t glbMagic = 0x46546C67;        // "glTF"
+  constexpr std::uint32_t binaryChunkType = 0x004E4942; // "BIN\0"
+
+  const auto read = [&glb](std::size_t offset) {
+    std::uint32_t value;
+    std::memcpy(&value, std::data(glb) + offset, sizeof(value));
+    return value;
+  };
+
+  if(std::size(glb) < 20 || read(0) != glbMagic)
+    return {};
+
+  const std::size_t binaryChunk = 20 + read(12); // header and JSON chunk
+  if(std::size(glb) < binaryChunk + 8 || read(binaryChunk + 4) != binaryChunkType)
+    return {};
+
+  return glb.subspan(binaryChunk + 8, std::min<std::size_t>(read(binaryChunk), std::size(glb) - binaryChunk - 8));
+}
+
+// Records the encoded bytes while tinygltf parses, decoding runs afterwards in Scene::decodeImages
+bool recordImage(tn::Image* image, const int imageIndex, std::string* error, std::string*, int, int, const unsigned char* bytes, int size, void* userData) {
+  auto* encodedImages = static_cast<std::vector<Scene::encoded_image_t>*>(userData);
+
+  Scene::encoded_image_t& encoded = encodedImages->emplace_back();
+  encoded.imageIndex = imageIndex;
+
+  if(image->bufferView == -1) // data URI or external file, the bytes are gone after this call
+    encoded.bytes.assign(bytes, bytes + size);
+
+  return true;
+}
 
-void Scene::setProgramID(GLuint programID) {
-  this->programID = programID;
 }
 
 bool Scene::load(const std::filesystem::path& modelglTFFile) {
+  const bool parsed = parse(modelglTFFile, {});
+  stage = load_stage_t::idle;
+
+  if(!parsed) {
+    unload();
+    return false;
+  }
+
+  upload();
+  return true;
+}
+
+void Scene::loadAsync(const std::filesystem::path& modelglTFFile) {
+  assert(loadStage() == load_stage_t::idle);
+
+  stage = load_stage_t::reading;
+  loader = std::jthread([this, modelglTFFile](std::stop_token stop) { stage = parse(modelglTFFile, stop) ? load_stage_t::parsed : load_stage_t::failed; });
+}
+
+bool Scene::finishLoad() {
+  assert(loadStage() == load_stage_t::parsed || loadStage() == load_stage_t::failed);
+
+  loader.join();
+
+  const bool parsed = stage == load_stage_t::parsed;
+  stage = load_stage_t::idle;
+
+  if(parsed)
+    upload();
+  else
+    unload(); // whatever the loader thread got to
+
+  return parsed;
+}
+
+void Scene::cancelLoad() {
+  if(!loader.joinable())
+    return;
+
+  loader.request_stop();
+  loader.join();
+
+  stage = load_stage_t::idle;
+  unload();
+}
+
+bool Scene::parse(const std::filesystem::path& modelglTFFile, std::stop_token stop) {
   assert(std::filesystem::exists(modelglTFFile));
 
+  stage = load_stage_t::reading;
+
+  mappedFile = util::MappedFile(modelglTFFile);
+  if(!mappedFile.isMapped())
+    return false;
+
+  const std::span<const unsigned char> bytes = mappedFile.bytes();
+
+  if(stop.stop_requested())
+    return false;
+
+  const std::filesystem::path cacheFile = sceneCachePath(modelglTFFile);
+  const std::uint64_t sourceHash = useSceneCache ? hashString(optimizeMeshes ? "optimized" : "", hashBytes(bytes)) : 0; // optimized and plain bakes don't mix
+
+  if(useSceneCache && readSceneCache(cacheFile, sourceHash, modelglTFFile.parent_path(), model, animations, nodeInstancing, meshStreams, meshLods, sceneCache)) { // no JSON parsing or image decoding
+    mappedFile.unmap();
+
+    bufferData = sceneCache.buffers;
+    imageData = sceneCache.images;
+
+    loadCameras();
+
+    return !stop.stop_requested();
+  }
+
+  stage = load_stage_t::parsing;
+  decodedImages = 0;
+  imageCount = 0;
+
+  std::vector<encoded_image_t> encodedImages;
+
+  tinygltf::TinyGLTF glTF_Loader;
+  glTF_Loader.SetImageLoader(recordImage, &encodedImages);
+
   std::string error, warning;
+  const std::string baseDir = modelglTFFile.parent_path().string();
 
-  if(tinygltf::TinyGLTF glTF_Loader; modelglTFFile.extension() == ".gltf")
-    glTF_Loader.LoadASCIIFromFile(&model, &error, &warning, modelglTFFile);
+  if(modelglTFFile.extension() == ".gltf")
+    glTF_Loader.LoadASCIIFromString(&model, &error, &warning, reinterpret_cast<const char*>(std::data(bytes)), std::size(bytes), baseDir);
   else if(modelglTFFile.extension() == ".glb")
-    glTF_Loader.LoadBinaryFromFile(&model, &error, &warning, modelglTFFile);
+    glTF_Loader.LoadBinaryFromMemory(&model, &error, &warning, std::data(bytes), std::size(bytes), baseDir);
 
   if(!warning.empty())
     std::println("Warning [TinyGLTF] {}", warning);
@@ -41,6 +173,128 @@ bool Scene::load(const std::filesystem::path& modelglTFFile) {
     return false;
   }
 
+  bufferData.clear();
+  for(tn::Buffer& buffer : model.buffers)
+    bufferData.emplace_back(buffer.data);
+
+  // tinygltf copied the BIN chunk into buffers[0], read it from the mapping instead and drop the copy
+  if(const std::span<const unsigned char> binaryChunk = glbBinaryChunk(bytes); !std::empty(binaryChunk) && !std::empty(model.buffers) && std::empty(model.buffers[0].uri)) {
+    bufferData[0] = binaryChunk.first(std::min(std::size(binaryChunk), std::size(model.buffers[0].data)));
+    model.buffers[0].data = {};
+  } else {
+    mappedFile.unmap(); // .gltf, everything was copied out of the JSON
+  }
+
+  if(!decodeImages(encodedImages, stop))
+    return false;
+
+  imageData.clear();
+  for(const tn::Image& image : model.images)
+    imageData.emplace_back(image.image);
+
+  loadCameras();
+  loadInstancing();
+
+  animations = compileAnimations(model, bufferData);
+
+  stage = load_stage_t::optimizing;
+  optimizeMeshGeometry(stop);
+
+  if(useSceneCache && !stop.stop_requested()) {
+    stage = load_stage_t::baking;
+    writeSceneCache(cacheFile, sourceHash, modelglTFFile.parent_path(), model, bufferData, imageData, animations, nodeInstancing, meshStreams, meshLods);
+  }
+
+  return !stop.stop_requested();
+}
+
+// Optimizes the indexed triangle primitives, when enabled, and builds their LOD chains from the optimized indices
+void Scene::optimizeMeshGeometry(std::stop_token stop) {
+  struct primitive_ref_t {
+    int mesh;
+    int primitive;
+  };
+
+  std::vector<primitive_ref_t> primitives;
+
+  meshStreams.assign(std::size(model.meshes), {});
+  meshLods.assign(std::size(model.meshes), {});
+  for(int m = 0; m < static_cast<int>(std::size(model.meshes)); ++m) {
+    meshStreams[m].resize(std::size(model.meshes[m].primitives));
+    meshLods[m].resize(std::size(model.meshes[m].primitives));
+
+    for(int p = 0; const tn::Primitive& primitive : model.meshes[m].primitives) {
+      if(primitive.mode == TINYGLTF_MODE_TRIANGLES && primitive.indices != -1 && primitive.attributes.contains("POSITION"))
+        primitives.push_back({m, p});
+      ++p;
+    }
+  }
+
+  std::vector<mesh_optimization_stats_t> stats(std::size(primitives));
+
+  const auto build = [&](std::size_t i) {
+    if(stop.stop_requested())
+      return;
+
+    const tn::Primitive& primitive = model.meshes[primitives[i].mesh].primitives[primitives[i].primitive];
+    vertex_streams_t& streams = meshStreams[primitives[i].mesh][primitives[i].primitive];
+    lod_chain_t& lods = meshLods[primitives[i].mesh][primitives[i].primitive];
+
+    // morph targets and skins index the exported vertex order, those primitives keep it
+    if(optimizeMeshes && std::empty(primitive.targets) && !primitive.attributes.contains("JOINTS_0")) {
+      streams = readVertexStreams(primitive);
+      stats[i] = optimizeMesh(streams);
+
+      lods = buildLodChain(streams.positions, streams.indices);
+      for(lod_level_t& level : lods)
+        optimizeVertexCache(level.indices, streams.vertexCount());
+      return;
+    }
+
+    std::vector<float> positions;
+    std::vector<std::uint32_t> indices;
+    appendAccessor(model, bufferData, primitive.attributes.at("POSITION"), positions);
+    appendIndices(model, bufferData, primitive.indices, indices);
+
+    lods = buildLodChain(positions, indices);
+  };
+
+  if(threadPool != nullptr)
+    threadPool->parallelFor(std::size(primitives), build);
+  else
+    for(std::size_t i = 0; i < std::size(primitives); ++i)
+      build(i);
+
+  if(!optimizeMeshes || stop.stop_requested())
+    return;
+
+  mesh_optimization_stats_t total;
+  for(const mesh_optimization_stats_t& primitiveStats : stats) {
+    total.before += primitiveStats.before;
+    total.after += primitiveStats.after;
+  }
+
+  std::println("[MeshOptimizer] {} triangles, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} -> {} vertices", total.after.triangles, total.before.acmr(), total.after.acmr(),
+               total.before.atvr(), total.after.atvr(), total.before.vertices, total.after.vertices);
+}
+
+// EXT_mesh_gpu_instancing accessor indices, the transforms are read when the nodes are uploaded
+void Scene::loadInstancing() {
+  nodeInstancing.assign(std::size(model.nodes), {});
+
+  for(std::size_t i = 0; i < std::size(model.nodes); ++i) {
+    const auto extension = model.nodes[i].extensions.find("EXT_mesh_gpu_instancing");
+    if(extension == std::end(model.nodes[i].extensions) || !extension->second.Has("attributes"))
+      continue;
+
+    const tn::Value& attributes = extension->second.Get("attributes");
+    const auto accessor = [&](const char* attribute) { return attributes.Has(attribute) ? attributes.Get(attribute).GetNumberAsInt() : -1; };
+
+    nodeInstancing[i] = {accessor("TRANSLATION"), accessor("ROTATION"), accessor("SCALE")};
+  }
+}
+
+void Scene::loadCameras() {
   for(int i = 0; const tn::Camera& cam : model.cameras) {
     Camera camera;
     std::string name = "Cam ";
@@ -60,60 +314,258 @@ bool Scene::load(const std::filesystem::path& modelglTFFile) {
     camera.name = std::move(name);
     cameras.push_back(std::move(camera));
   }
+}
+
+bool Scene::decodeImages(std::span<const encoded_image_t> encodedImages, std::stop_token stop) {
+  stage = load_stage_t::decoding;
+  imageCount = std::size(encodedImages);
+
+  struct result_t {
+    bool decoded = false;
+    std::string error, warning;
+  };
+
+  std::vector<result_t> results(std::size(encodedImages));
+
+  // the same decoder tinygltf runs, each task writes only its own image and result
+  const auto decode = [&](std::size_t i) {
+    if(stop.stop_requested())
+      return;
+
+    const encoded_image_t& encoded = encodedImages[i];
+    tn::Image& image = model.images[encoded.imageIndex];
+
+    const unsigned char* bytes = std::data(encoded.bytes);
+    std::size_t size = std::size(encoded.bytes);
+
+    if(image.bufferView != -1) {
+      bytes = bufferViewData(model, bufferData, image.bufferView);
+      size = model.bufferViews[image.bufferView].byteLength;
+    }
+
+    results[i].decoded = tn::LoadImageData(&image, encoded.imageIndex, &results[i].error, &results[i].warning, 0, 0, bytes, static_cast<int>(size), nullptr);
+    ++decodedImages;
+  };
+
+  if(threadPool != nullptr)
+    threadPool->parallelFor(std::size(encodedImages), decode);
+  else
+    for(std::size_t i = 0; i < std::size(encodedImages); ++i)
+      decode(i);
+
+  if(stop.stop_requested())
+    return false;
+
+  bool decoded = true;
+  for(const result_t& result : results) {
+    if(!result.warning.empty())
+      std::println("Warning [TinyGLTF] {}", result.warning);
+
+    if(!result.decoded) {
+      std::println("Error [TinyGLTF] {}", result.error);
+      decoded = false;
+    }
+  }
+
+  return decoded;
+}
+
+void Scene::upload() {
+  loadMaterials();
+
+  nodeSlots.assign(std::size(model.nodes), -1);
+  bufferViewBuffers.assign(std::size(model.bufferViews), 0);
+  meshes.assign(std::size(model.meshes), {});
 
   for(const tn::Scene& scene : model.scenes)
     visitScene(scene);
 
-  return true;
+  for(const node_t& buffer : buffers) {
+    if(buffer.type == node_t::type_t::mesh) {
+      primitives += std::size(meshes[buffer.mesh].primitives);
+      instances += std::size(meshes[buffer.mesh].primitives) * std::max<std::size_t>(std::size(buffer.instances), 1);
+    }
+  }
+
+  uploadGeometryArenas();
+  hierarchy.update();
+  loadSkins();
+
+  if(!std::empty(morphDeltas)) {
+    glCreateBuffers(1, &morphDeltaBufferID);
+    glNamedBufferStorage(morphDeltaBufferID, std::size(morphDeltas) * sizeof(glm::vec4), std::data(morphDeltas), 0);
+    morphDeltas = {};
+  }
+
+  if(!std::empty(morphWeights)) { // room for every weight being active
+    glCreateBuffers(1, &morphWeightBufferID);
+    glNamedBufferStorage(morphWeightBufferID, std::size(morphWeights) * sizeof(morph_weight_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+  }
+  updateMorphWeights();
+
+  worldBounds.resize(hierarchy.size());
+  updateWorldBounds();
+
+  std::vector<int> boundedSlots;
+  std::vector<aabb_t> boundedBoxes;
+  for(int slot = 0; slot < static_cast<int>(hierarchy.size()); ++slot) {
+    if(!localBounds[slot].empty()) {
+      boundedSlots.push_back(slot);
+      boundedBoxes.push_back(worldBounds.get(slot));
+    }
+  }
+  bvh.build(boundedSlots, boundedBoxes);
+
+  groupAnimationChannels();
 }
 
 void Scene::unload() {
-  for(const auto& [_, buffer] : buffers) {
-    if(glIsBuffer(buffer.mesh_buffer.vertexArrayID))
-      glDeleteVertexArrays(1, &buffer.mesh_buffer.vertexArrayID);
+  // buffer view buffers are shared, only the primitives' own buffers go here
+  std::vector<GLuint> shared = bufferViewBuffers;
+  std::ranges::sort(shared);
 
-    if(glIsBuffer(buffer.mesh_buffer.vertexAttribute.positionBufferID))
-      glDeleteBuffers(1, &buffer.mesh_buffer.vertexAttribute.positionBufferID);
-
-    if(glIsBuffer(buffer.mesh_buffer.vertexAttribute.normalBufferID))
-      glDeleteBuffers(1, &buffer.mesh_buffer.vertexAttribute.normalBufferID);
+  const auto deleteOwnBuffer = [&](GLuint id) {
+    if(glIsBuffer(id) && !std::ranges::binary_search(shared, id))
+      glDeleteBuffers(1, &id);
+  };
 
-    if(glIsBuffer(buffer.mesh_buffer.element.elementBufferID))
-      glDeleteBuffers(1, &buffer.mesh_buffer.element.elementBufferID);
+  for(const mesh_buffer_t& mesh_buffer : meshes) {
+    for(const primitive_buffer_t& primitive_buffer : mesh_buffer.primitives) {
+      if(primitive_buffer.arenaRange.arena == -1 && glIsVertexArray(primitive_buffer.vertexArrayID))
+        glDeleteVertexArrays(1, &primitive_buffer.vertexArrayID);
 
-    if(glIsTexture(buffer.mesh_buffer.material.normalTexture.textureID))
-      glDeleteTextures(1, &buffer.mesh_buffer.material.normalTexture.textureID);
+      deleteOwnBuffer(primitive_buffer.vertexAttribute.positionBufferID);
+      deleteOwnBuffer(primitive_buffer.vertexAttribute.normalBufferID);
+      deleteOwnBuffer(primitive_buffer.vertexAttribute.tangentBufferID);
 
-    if(glIsTexture(buffer.mesh_buffer.material.occlusionTexture.textureID))
-      glDeleteTextures(1, &buffer.mesh_buffer.material.occlusionTexture.textureID);
+      for(const auto& [_, textureCoordinateBufferID] : primitive_buffer.vertexAttribute.textureCoordinateBufferIDs)
+        deleteOwnBuffer(textureCoordinateBufferID);
 
-    if(glIsTexture(buffer.mesh_buffer.material.emissiveTexture.textureID))
-      glDeleteTextures(1, &buffer.mesh_buffer.material.emissiveTexture.textureID);
+      deleteOwnBuffer(primitive_buffer.vertexAttribute.jointsBufferID);
+      deleteOwnBuffer(primitive_buffer.vertexAttribute.weightsBufferID);
 
-    if(glIsTexture(buffer.mesh_buffer.material.pbr.baseColorTexture.textureID))
-      glDeleteTextures(1, &buffer.mesh_buffer.material.pbr.baseColorTexture.textureID);
+      deleteOwnBuffer(primitive_buffer.element.elementBufferID);
+    }
+  }
 
-    if(glIsTexture(buffer.mesh_buffer.material.pbr.metallicRoughnessTexture.textureID))
-      glDeleteTextures(1, &buffer.mesh_buffer.material.pbr.metallicRoughnessTexture.textureID);
+  for(GLuint id : bufferViewBuffers)
+    if(id != 0)
+      glDeleteBuffers(1, &id);
+  bufferViewBuffers.clear();
+
+  for(const material_t& material : materials)
+    for(GLuint textureID : material.textures)
+      if(textureID != 0)
+        textureCache.release(textureID);
+  assert(textureCache.size() == 0);
+  samplerCache.clear();
+
+  if(glIsBuffer(materialBufferID))
+    glDeleteBuffers(1, &materialBufferID);
+  materialBufferID = 0;
+
+  if(glIsBuffer(jointPaletteBufferID))
+    glDeleteBuffers(1, &jointPaletteBufferID);
+  jointPaletteBufferID = 0;
+
+  for(GLuint* id : {&morphDeltaBufferID, &morphWeightBufferID}) {
+    if(glIsBuffer(*id))
+      glDeleteBuffers(1, id);
+    *id = 0;
   }
+
+  arenas.unload();
+
+  bufferData.clear();
+  imageData.clear();
+  mappedFile.unmap();
+  sceneCache = {};
+
+  buffers.clear();
+  meshes.clear();
+  nodeSlots.clear();
+  hierarchy.clear();
+  localBounds.clear();
+  worldBounds.resize(0);
+  bvh.clear();
+  primitives = 0;
+  instances = 0;
+  nodeInstancing.clear();
+  meshStreams.clear();
+  meshLods.clear();
+  cameras.clear();
+  skins.clear();
+  jointPalette.clear();
+  skinnedSlots.clear();
+  morphWeights.clear();
+  activeMorphWeights.clear();
+  morphedSlots.clear();
+  morphDeltas.clear();
+  materials.clear();
+  textureSets.clear();
+
+  animations.clear();
+  animatedNodes.clear();
+  animatedChannels.clear();
+  clipTimes.clear();
 }
 
 void Scene::visitScene(const tn::Scene& scene) {
-  for(int nodeIndex : scene.nodes) {
-    glm::mat4x4 defaultTransform = glm::mat4x4(1.0);
-    visitNode(nodeIndex, defaultTransform);
+  std::vector<std::pair<int, int>> stack; // node index, parent slot
+
+  for(int nodeIndex : scene.nodes | std::views::reverse)
+    stack.emplace_back(nodeIndex, -1);
+
+  while(!std::empty(stack)) {
+    const auto [nodeIndex, parentSlot] = stack.back();
+    stack.pop_back();
+
+    if(nodeSlots[nodeIndex] != -1) // already visited through another scene
+      continue;
+
+    const int slot = visitNode(nodeIndex, parentSlot);
+
+    for(int childIndex : model.nodes[nodeIndex].children | std::views::reverse)
+      stack.emplace_back(childIndex, slot);
   }
 }
 
-void Scene::visitNode(const int nodeIndex, const glm::mat4x4& parentNodeTransform) {
+int Scene::visitNode(const int nodeIndex, const int parentSlot) {
   const tn::Node& node = model.nodes[nodeIndex];
 
+  const int slot = hierarchy.add(parentSlot);
+  nodeSlots[nodeIndex] = slot;
+
   node_t buffer;
+  aabb_t bounds;
 
   if(int meshIndex = node.mesh; meshIndex != -1) {
     buffer.type = node_t::type_t::mesh;
-    const tn::Mesh& mesh = model.meshes[meshIndex];
-    visitNodeMesh(mesh, buffer.mesh_buffer);
+    buffer.mesh = meshIndex;
+
+    if(std::empty(meshes[meshIndex].primitives)) // first node with this mesh
+      visitMesh(meshIndex);
+    buffer.lods.assign(std::size(meshes[meshIndex].primitives), 0);
+
+    bounds = meshes[meshIndex].bounds;
+
+    if(node.skin != -1) {
+      buffer.skin = node.skin;
+      skinnedSlots.push_back(slot);
+    }
+
+    loadMorphWeights(buffer, node);
+    if(buffer.morph.count != 0)
+      morphedSlots.push_back(slot);
+
+    if(!nodeInstancing[nodeIndex].empty()) {
+      loadNodeInstances(buffer, nodeInstancing[nodeIndex]);
+
+      aabb_t instanceBounds;
+      for(const glm::mat4x4& instance : buffer.instances)
+        instanceBounds.extend(transformBounds(bounds, instance));
+      bounds = instanceBounds;
+    }
   }
 
   if(int cameraIndex = node.camera; cameraIndex != -1) {
@@ -122,531 +574,717 @@ void Scene::visitNode(const int nodeIndex, const glm::mat4x4& parentNodeTransfor
   }
 
   if(!std::empty(node.matrix) || !std::empty(node.translation) || !std::empty(node.rotation) || !std::empty(node.scale)) {
-    loadNodeTransformData(node, buffer, parentNodeTransform);
+    loadNodeTransformData(node, slot);
   }
 
-  buffers[nodeIndex] = std::move(buffer);
+  buffers.push_back(std::move(buffer));
+  localBounds.push_back(bounds);
 
-  if(!empty(node.children)) {
-    for(int nodeIndex : node.children)
-      visitNode(nodeIndex, buffer.transformMatrix_);
-  }
+  return slot;
 }
 
-void Scene::visitNodeMesh(const tn::Mesh& mesh, mesh_buffer_t& mesh_buffer) {
-  glGenVertexArrays(1, &mesh_buffer.vertexArrayID);
-  glBindVertexArray(mesh_buffer.vertexArrayID);
+void Scene::visitMesh(int meshIndex) {
+  const tn::Mesh& mesh = model.meshes[meshIndex];
+  mesh_buffer_t& mesh_buffer = meshes[meshIndex];
 
-  for(const tn::Primitive& primitive : mesh.primitives) {
-    visitMeshPrimitive(mesh_buffer, primitive);
-  }
+  mesh_buffer.bounds = meshBounds(mesh);
+  const aabb_t& bounds = mesh_buffer.bounds;
+
+  // one dequantization for all primitives, positions outside the POSITION min and max are clamped
+  vertex_quantization_t quantization;
+  if(!bounds.empty())
+    quantization = {bounds.min, glm::max(bounds.max - bounds.min, glm::vec3(std::numeric_limits<float>::min()))};
 
-  for(size_t i = 0; i < mesh.weights.size(); ++i) {
+  for(std::size_t i = 0; i < std::size(mesh.primitives); ++i) {
+    primitive_buffer_t& primitive_buffer = mesh_buffer.primitives.emplace_back();
+    visitMeshPrimitive(primitive_buffer, mesh.primitives[i], meshStreams[meshIndex][i], meshLods[meshIndex][i], quantization);
   }
 }
 
-void Scene::visitMeshPrimitive(mesh_buffer_t& mesh_buffer, const tn::Primitive& primitive) {
-  for(const auto& [attribute, accessorIndex] : primitive.attributes) {
-    if(attribute == "POSITION")
-      loadMeshVertexPositionData(mesh_buffer, accessorIndex);
+void Scene::visitMeshPrimitive(primitive_buffer_t& primitive_buffer, const tn::Primitive& primitive, const vertex_streams_t& streams, const lod_chain_t& lods,
+                               const vertex_quantization_t& quantization) {
+  primitive_buffer.element.mode = primitive.mode;
+
+  const bool optimized = !std::empty(streams.indices);
+  const std::uint32_t quantized = quantizeVertices ? quantizedStreams : 0;
+
+  // skinned and morphed primitives keep the exported accessors, the arena formats have no joints and morph deltas are indexed by the exported vertex
+  if(geometryMode == geometry_mode_t::merged && primitive.mode == TINYGLTF_MODE_TRIANGLES && primitive.attributes.contains("POSITION") &&
+     !primitive.attributes.contains("JOINTS_0") && std::empty(primitive.targets)) {
+    vertex_streams_t exported;
+    if(!optimized)
+      exported = readVertexStreams(primitive);
+    const vertex_streams_t& source = optimized ? streams : exported;
+
+    primitive_buffer.vertexFormat = source.format() | quantized;
+    primitive_buffer.quantization = quantization;
+    primitive_buffer.arenaRange = arenas.add(source, primitive_buffer.vertexFormat, quantization);
+
+    if(!std::empty(lods)) {
+      primitive_buffer.lods.push_back({primitive_buffer.arenaRange.firstIndex, primitive_buffer.arenaRange.indexCount, 0.0f});
+      for(const lod_level_t& level : lods)
+        primitive_buffer.lods.push_back({arenas.addIndices(primitive_buffer.arenaRange, level.indices), static_cast<std::uint32_t>(std::size(level.indices)), level.error});
+    }
+  } else if(optimized) {
+    glGenVertexArrays(1, &primitive_buffer.vertexArrayID);
+    glBindVertexArray(primitive_buffer.vertexArrayID);
 
-    if(attribute == "NORMAL")
-      loadMeshVertexNormalData(mesh_buffer, accessorIndex);
+    primitive_buffer.vertexFormat = streams.format() | quantized;
+    primitive_buffer.quantization = quantization;
+    loadMeshStreams(primitive_buffer, streams, lods);
+  } else {
+    glGenVertexArrays(1, &primitive_buffer.vertexArrayID);
+    glBindVertexArray(primitive_buffer.vertexArrayID);
 
-    if(attribute.starts_with("TEXCOORD_"))
-      loadMeshTextureCoordinateData(mesh_buffer, accessorIndex, attribute);
+    for(const auto& [attribute, accessorIndex] : primitive.attributes) {
+      if(attribute == "POSITION")
+        loadMeshVertexPositionData(primitive_buffer, accessorIndex);
 
-    if(attribute == "TANGENT")
-      loadMeshTangentialDirectionData(mesh_buffer, accessorIndex);
-  }
+      if(attribute == "NORMAL")
+        loadMeshVertexNormalData(primitive_buffer, accessorIndex);
 
-  if(primitive.indices != -1) {
-    mesh_buffer.element.mode = primitive.mode;
-    loadMeshDrawIndices(mesh_buffer, primitive.indices);
-  }
+      if(attribute.starts_with("TEXCOORD_"))
+        loadMeshTextureCoordinateData(primitive_buffer, accessorIndex, attribute);
 
-  if(primitive.material != -1) {
-    loadMeshMaterial(mesh_buffer, primitive.material);
-  }
-
-  for(const std::map<std::string, int>& morphTarget : primitive.targets) { // morph targets
-    for(const auto& [attribute, accessorIndex] : morphTarget) {
-      if(attribute == "POSITION") { // vec3, float
-        const tn::Accessor& accessor = model.accessors[accessorIndex];
-        const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
-        const tn::Buffer& buf = model.buffers[bv.buffer];
+      if(attribute == "TANGENT")
+        loadMeshTangentialDirectionData(primitive_buffer, accessorIndex);
+    }
 
-        const auto begin = reinterpret_cast<glm::vec3*>(const_cast<unsigned char*>(std::data(buf.data)) + bv.byteOffset + accessor.byteOffset);
-        const auto end = begin + accessor.count;
+    if(primitive.attributes.contains("JOINTS_0") && primitive.attributes.contains("WEIGHTS_0"))
+      loadMeshSkinData(primitive_buffer, primitive.attributes.at("JOINTS_0"), primitive.attributes.at("WEIGHTS_0"));
 
-        const std::span<glm::vec3> positionDeltas(begin, end);
-        for(const glm::vec3& e : positionDeltas) {
-          std::println("{}", glm::to_string(e));
-        }
-      }
+    if(primitive.indices != -1) {
+      if(std::empty(lods))
+        loadMeshDrawIndices(primitive_buffer, primitive.indices);
+      else
+        loadMeshLodIndices(primitive_buffer, primitive.indices, lods);
     }
   }
-}
 
-void Scene::animate(float currentTime) {
+  primitive_buffer.materialIndex = primitive.material != -1 ? primitive.material : static_cast<int>(std::size(materials)) - 1; // default material
 
-  for(tn::Animation animation : model.animations) {
+  if(!std::empty(primitive.targets))
+    loadMorphTargets(primitive_buffer, primitive);
+}
 
-    const std::vector<tn::AnimationChannel>& channels = animation.channels;
+aabb_t Scene::meshBounds(const tn::Mesh& mesh) const {
+  aabb_t bounds;
 
-    for(glm::mat4x4 TRS(1.0f); const tn::AnimationChannel& c : channels) {
-      const tn::AnimationSampler& animationSampler = animation.samplers[c.sampler];
+  for(const tn::Primitive& primitive : mesh.primitives) {
+    const auto position = primitive.attributes.find("POSITION");
+    if(position == std::end(primitive.attributes))
+      continue;
+
+    const tn::Accessor& accessor = model.accessors[position->second];
+    if(!accessor.normalized && std::size(accessor.minValues) == 3 && std::size(accessor.maxValues) == 3) { // normalized min and max are in integer units
+      bounds.extend(glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]));
+      bounds.extend(glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]));
+      continue;
+    }
 
-      const tn::Accessor& inputAccessor = model.accessors[animationSampler.input];
-      const tn::BufferView& inputBufferView = model.bufferViews[inputAccessor.bufferView];
-      const tn::Buffer& inputBuffer = model.buffers[inputBufferView.buffer];
+    std::vector<float> positions; // min and max are required, but not every exporter writes them
+    appendAccessor(model, bufferData, position->second, positions);
+    for(std::size_t i = 0; i + 2 < std::size(positions); i += 3)
+      bounds.extend(glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+  }
 
-      const auto input_begin = reinterpret_cast<float*>(const_cast<unsigned char*>(std::data(inputBuffer.data)) + inputBufferView.byteOffset + inputAccessor.byteOffset);
-      const auto input_end = input_begin + inputAccessor.count;
+  // how far the morph targets reach with weights up to 1, the widest primitive decides
+  glm::vec3 reachMin(0.0f), reachMax(0.0f);
+  for(const tn::Primitive& primitive : mesh.primitives) {
+    glm::vec3 primitiveMin(0.0f), primitiveMax(0.0f);
 
-      const std::span<float> input(input_begin, input_end); //  keyframe timestamps
+    for(const std::map<std::string, int>& target : primitive.targets) {
+      const auto position = target.find("POSITION");
+      if(position == std::end(target))
+        continue;
 
-      currentTime = std::fmod(currentTime, input.back()); // time normalized
+      const tn::Accessor& accessor = model.accessors[position->second];
+      if(std::size(accessor.minValues) == 3 && std::size(accessor.maxValues) == 3) { // required for POSITION deltas
+        primitiveMin += glm::min(glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]), glm::vec3(0.0f));
+        primitiveMax += glm::max(glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]), glm::vec3(0.0f));
+      }
+    }
 
-      auto prev_pos = std::lower_bound(input.begin(), input.end(), currentTime);
-      auto next_pos = std::upper_bound(input.begin(), input.end(), currentTime);
+    reachMin = glm::min(reachMin, primitiveMin);
+    reachMax = glm::max(reachMax, primitiveMax);
+  }
 
-      prev_pos = (prev_pos == input.begin()) ? prev_pos : std::prev(prev_pos);
-      next_pos = (next_pos == input.end()) ? std::prev(next_pos) : next_pos;
+  if(!bounds.empty()) {
+    bounds.min += reachMin;
+    bounds.max += reachMax;
+  }
 
-      const std::size_t prev_pos_index = std::distance(input.begin(), prev_pos);
-      const std::size_t next_pos_index = std::distance(input.begin(), next_pos);
+  return bounds;
+}
 
-      const float previousTime = input[prev_pos_index];
-      const float nextTime = input[next_pos_index];
+vertex_streams_t Scene::readVertexStreams(const tn::Primitive& primitive) const {
+  vertex_streams_t streams;
 
-      const float interpolant = (currentTime - previousTime) / (nextTime - previousTime);
+  for(const auto& [attribute, accessorIndex] : primitive.attributes) {
+    if(attribute == "POSITION")
+      appendAccessor(model, bufferData, accessorIndex, streams.positions);
 
-      const tn::Accessor& outputAccessor = model.accessors[animationSampler.output];
-      const tn::BufferView& outputBufferView = model.bufferViews[outputAccessor.bufferView];
-      const tn::Buffer& outputBuffer = model.buffers[outputBufferView.buffer];
+    if(attribute == "NORMAL")
+      appendAccessor(model, bufferData, accessorIndex, streams.normals);
 
-      const tn::Node& target_node = model.nodes[c.target_node];
+    if(attribute == "TANGENT")
+      appendAccessor(model, bufferData, accessorIndex, streams.tangents);
 
-      if(c.target_path == "translation") {
-        const auto output_begin = reinterpret_cast<glm::vec3*>(const_cast<unsigned char*>(std::data(outputBuffer.data)) + outputBufferView.byteOffset + outputAccessor.byteOffset);
-        const auto output_end = output_begin + outputAccessor.count;
+    if(attribute == "TEXCOORD_0")
+      appendAccessor(model, bufferData, accessorIndex, streams.texcoords);
+  }
 
-        const std::span<glm::vec3> output(output_begin, output_end);
+  if(primitive.indices != -1) {
+    appendIndices(model, bufferData, primitive.indices, streams.indices);
+  } else {
+    streams.indices.resize(streams.vertexCount());
+    std::iota(std::begin(streams.indices), std::end(streams.indices), 0u);
+  }
 
-        const glm::vec3& previousTranslation = output[prev_pos_index];
-        const glm::vec3& nextTranslation = output[next_pos_index];
+  return streams;
+}
 
-        glm::vec3 currentTranslation;
-        if(animationSampler.interpolation == "STEP") {
-          currentTranslation = previousTranslation;
-        }
+void Scene::uploadGeometryArenas() {
+  arenas.upload();
 
-        else if(animationSampler.interpolation == "LINEAR") {
-          currentTranslation = glm::mix(previousTranslation, nextTranslation, interpolant); // previousTranslation + interpolant * (nextTranslation - previousTranslation); // (lerp)
-        }
+  for(mesh_buffer_t& mesh_buffer : meshes)
+    for(primitive_buffer_t& primitive_buffer : mesh_buffer.primitives)
+      if(const int arena = primitive_buffer.arenaRange.arena; arena != -1)
+        primitive_buffer.vertexArrayID = arenas.arenas[arena].vertexArrayID;
+}
 
-        else if(animationSampler.interpolation == "CUBICSPLINE") {
-          // const glm::vec3& a_prev = output[prev_pos_index * 3 + 0];
-          const glm::vec3& v_prev = output[prev_pos_index * 3 + 1];
-          const glm::vec3& b_prev = output[prev_pos_index * 3 + 2];
+void Scene::groupAnimationChannels() {
+  std::map<int, std::vector<channel_ref_t>> channelsBySlot; // ordered, parents before children
 
-          const glm::vec3& a_next = output[next_pos_index * 3 + 0];
-          const glm::vec3& v_next = output[next_pos_index * 3 + 1];
-          // const glm::vec3& b_next = output[next_pos_index * 3 + 2];
+  for(std::uint32_t i = 0; i < std::size(animations); ++i) {
+    for(std::uint32_t j = 0; j < std::size(animations[i].channels); ++j) {
+      if(const int slot = nodeSlots[animations[i].channels[j].targetNode]; slot != -1)
+        channelsBySlot[slot].push_back({i, j});
+    }
+  }
 
-          const float t = interpolant;
-          const float td = nextTime - previousTime;
+  animatedNodes.clear();
+  animatedChannels.clear();
 
-          const float t2 = std::pow(t, 2);
-          const float t3 = std::pow(t, 3);
+  for(auto& [slot, channels] : channelsBySlot) {
+    animatedNodes.push_back({slot, static_cast<std::uint32_t>(std::size(animatedChannels)), static_cast<std::uint32_t>(std::size(channels))});
+    animatedChannels.insert(std::end(animatedChannels), std::begin(channels), std::end(channels));
+  }
 
-          // clang-format off
-          // https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#interpolation-cubic
-          currentTranslation =
-            (2.0f*t3 - 3.0f*t2 + 1.0f) * v_prev
-            +
-            td * (t3 - 2.0f*t2 + t) * b_prev
-            +
-            (-2.0f*t3 + 3.0f*t2) * v_next
-            +
-            td * (t3 -t2) * a_next;
-          // clang-format on
-        }
+  clipTimes.assign(std::size(animations), 0.0f);
+}
 
-        else {
-          std::unreachable();
-        }
+void Scene::animate(float currentTime) {
+  for(std::size_t i = 0; i < std::size(animations); ++i) {
+    const float duration = animations[i].duration;
+    clipTimes[i] = duration > 0.0f ? std::fmod(currentTime, duration) : 0.0f; // time normalized
+  }
 
-        TRS *= glm::translate(glm::mat4x4(1.0), currentTranslation);
-      }
+  if(animationMode == animation_mode_t::parallel && threadPool != nullptr)
+    threadPool->parallelFor(std::size(animatedNodes), [this](std::size_t i) { animateNode(animatedNodes[i]); });
+  else
+    for(const animated_node_t& animatedNode : animatedNodes)
+      animateNode(animatedNode);
 
-      else if(c.target_path == "rotation") {
-        const auto output_begin = reinterpret_cast<glm::quat*>(const_cast<unsigned char*>(std::data(outputBuffer.data)) + outputBufferView.byteOffset + outputAccessor.byteOffset);
-        const auto output_end = output_begin + outputAccessor.count;
+  hierarchy.update();
+  updateSkins();
+  updateMorphWeights();
+  updateWorldBounds();
+}
 
-        const std::span<glm::quat> output(output_begin, output_end);
+void Scene::updateWorldBounds() {
+  for(std::size_t slot = 0; slot < hierarchy.size(); ++slot) {
+    if(!hierarchy.changed[slot] || localBounds[slot].empty() || buffers[slot].skin != -1)
+      continue;
 
-        const glm::quat& previousRotation = output[prev_pos_index];
-        const glm::quat& nextRotation = output[next_pos_index];
+    const aabb_t bounds = transformBounds(localBounds[slot], hierarchy.world[slot]);
+    worldBounds.set(slot, bounds);
 
-        glm::quat currentRotation;
-        if(animationSampler.interpolation == "STEP") {
-          currentRotation = previousRotation;
-        }
+    if(bvh.contains(static_cast<int>(slot))) // built after the first update
+      bvh.update(static_cast<int>(slot), bounds);
+  }
 
-        else if(animationSampler.interpolation == "LINEAR") {
-          currentRotation = glm::slerp(previousRotation, nextRotation, interpolant);
-        }
+  // a skinned vertex is a weighted mean of its joint matrices applied to it, so it stays inside the mesh bounds moved by every joint
+  for(const int slot : skinnedSlots) {
+    const skin_t& skin = skins[buffers[slot].skin];
+    const aabb_t& bindPose = meshes[buffers[slot].mesh].bounds;
 
-        else if(animationSampler.interpolation == "CUBICSPLINE") {
-          const glm::quat& v_prev = output[prev_pos_index * 3 + 1];
-          const glm::quat& b_prev = output[prev_pos_index * 3 + 2];
+    aabb_t bounds;
+    for(std::uint32_t i = 0; i < skin.jointCount; ++i)
+      bounds.extend(transformBounds(bindPose, jointPalette.matrices[skin.firstJoint + i]));
+    worldBounds.set(slot, bounds);
 
-          const glm::quat& a_next = output[next_pos_index * 3 + 0];
-          const glm::quat& v_next = output[next_pos_index * 3 + 1];
+    if(bvh.contains(slot))
+      bvh.update(slot, bounds);
+  }
+}
 
-          const float t = interpolant;
-          const float td = nextTime - previousTime;
+// Joint slots and inverse bind matrices of every skin, one palette buffer for all of them
+void Scene::loadSkins() {
+  for(const tn::Skin& skin : model.skins) {
+    std::vector<int> slots;
+    for(int joint : skin.joints)
+      slots.push_back(nodeSlots[joint]);
 
-          const float t2 = std::pow(t, 2);
-          const float t3 = std::pow(t, 3);
+    std::vector<float> inverseBind; // identities when absent
+    if(skin.inverseBindMatrices != -1)
+      appendAccessor(model, bufferData, skin.inverseBindMatrices, inverseBind);
 
-          currentRotation = (2.0f * t3 - 3.0f * t2 + 1.0f) * v_prev + td * (t3 - 2.0f * t2 + t) * b_prev + (-2.0f * t3 + 3.0f * t2) * v_next + td * (t3 - t2) * a_next;
+    skins.push_back(jointPalette.add(slots, inverseBind));
+  }
 
-          currentRotation = glm::normalize(currentRotation);
-        }
+  if(jointPalette.size() == 0)
+    return;
 
-        else {
-          std::unreachable();
-        }
+  glCreateBuffers(1, &jointPaletteBufferID);
+  glNamedBufferStorage(jointPaletteBufferID, jointPalette.size() * sizeof(glm::mat4x4), nullptr, GL_DYNAMIC_STORAGE_BIT);
 
-        // std::println("{} {}", currentTime_, glm::to_string(currentRotation));
-        TRS *= glm::mat4_cast(currentRotation);
-      }
+  updateSkins();
+}
 
-      else if(c.target_path == "scale") {
-        const auto output_begin = reinterpret_cast<glm::vec3*>(const_cast<unsigned char*>(std::data(outputBuffer.data)) + outputBufferView.byteOffset + outputAccessor.byteOffset);
-        const auto output_end = output_begin + outputAccessor.count;
+// Only the non-zero weights reach the vertex shader, a face rig has most of its targets at rest
+void Scene::updateMorphWeights() {
+  if(std::empty(morphedSlots))
+    return;
 
-        const std::span<glm::vec3> output(output_begin, output_end);
-        const glm::vec3& previousScale = output[prev_pos_index];
-        const glm::vec3& nextScale = output[next_pos_index];
+  activeMorphWeights.clear();
 
-        glm::vec3 currentScale;
-        if(animationSampler.interpolation == "STEP") {
-          currentScale = previousScale;
-        }
+  for(const int slot : morphedSlots) {
+    node_t::morph_weights_t& morph = buffers[slot].morph;
+    morph.firstActive = std::size(activeMorphWeights);
 
-        else if(animationSampler.interpolation == "LINEAR") {
-          currentScale = glm::mix(previousScale, nextScale, interpolant);
-        }
+    for(std::uint32_t target = 0; target < morph.count; ++target)
+      if(const float weight = morphWeights[morph.first + target]; weight != 0.0f)
+        activeMorphWeights.push_back({target, weight});
 
-        else if(animationSampler.interpolation == "CUBICSPLINE") {
-          const glm::vec3& v_prev = output[prev_pos_index * 3 + 1];
-          const glm::vec3& b_prev = output[prev_pos_index * 3 + 2];
+    morph.activeCount = std::size(activeMorphWeights) - morph.firstActive;
+  }
 
-          const glm::vec3& a_next = output[next_pos_index * 3 + 0];
-          const glm::vec3& v_next = output[next_pos_index * 3 + 1];
+  glNamedBufferSubData(morphWeightBufferID, 0, std::size(activeMorphWeights) * sizeof(morph_weight_t), std::data(activeMorphWeights));
 
-          const float t = interpolant;
-          const float td = nextTime - previousTime;
+  assert(glGetError() == GL_NO_ERROR);
+}
 
-          const float t2 = std::pow(t, 2);
-          const float t3 = std::pow(t, 3);
+void Scene::updateSkins() {
+  const std::size_t n = jointPalette.size();
+  if(n == 0)
+    return;
 
-          currentScale = (2.0f * t3 - 3.0f * t2 + 1.0f) * v_prev + td * (t3 - 2.0f * t2 + t) * b_prev + (-2.0f * t3 + 3.0f * t2) * v_next + td * (t3 - t2) * a_next;
-        }
+  constexpr std::size_t chunk = 1024; // joints per task
+  if(animationMode == animation_mode_t::parallel && threadPool != nullptr && n > chunk)
+    threadPool->parallelFor((n + chunk - 1) / chunk, [&](std::size_t i) { jointPalette.update(hierarchy.world, i * chunk, std::min(chunk, n - i * chunk)); });
+  else
+    jointPalette.update(hierarchy.world, 0, n);
 
-        else {
-          std::unreachable();
-        }
+  glNamedBufferSubData(jointPaletteBufferID, 0, n * sizeof(glm::mat4x4), std::data(jointPalette.matrices));
 
-        TRS *= glm::scale(glm::mat4x4(1.0f), currentScale);
-      }
+  assert(glGetError() == GL_NO_ERROR);
+}
 
-      else if(c.target_path == "weights") {
-      }
+void Scene::animateNode(const animated_node_t& animatedNode) {
+  const int slot = animatedNode.slot;
 
-      else {
-        std::unreachable();
-      }
+  for(std::uint32_t i = 0; i < animatedNode.channelCount; ++i) {
+    const channel_ref_t& ref = animatedChannels[animatedNode.firstChannel + i];
 
-      buffers[c.target_node].transformMatrix_ = TRS;
+    animation_clip_t& clip = animations[ref.clip];
+    animation_channel_t& channel = clip.channels[ref.channel];
+    const float time = clipTimes[ref.clip];
+
+    switch(channel.path) {
+    case animation_path_t::translation: sampleChannel(clip, channel, time, glm::value_ptr(hierarchy.translation[slot])); break;
+    case animation_path_t::rotation:    sampleChannel(clip, channel, time, glm::value_ptr(hierarchy.rotation[slot])); break;
+    case animation_path_t::scale:       sampleChannel(clip, channel, time, glm::value_ptr(hierarchy.scale[slot])); break;
+    case animation_path_t::weights:
+      if(const node_t::morph_weights_t& morph = buffers[slot].morph; clip.samplers[channel.sampler].components == morph.count)
+        sampleChannel(clip, channel, time, std::data(morphWeights) + morph.first);
+      continue; // no transform changed
     }
+
+    hierarchy.markDirty(slot);
   }
 }
 
-void Scene::loadNodeTransformData(const tn::Node& node, node_t& buffer, const glm::mat4x4& parentNodeTransform) {
+void Scene::loadNodeTransformData(const tn::Node& node, int slot) {
   if(!std::empty(node.matrix)) {
-    buffer.transformMatrix_ = parentNodeTransform * glm::mat4x4(glm::make_mat4x4(std::data(node.matrix)));
-  } else {
-    glm::mat4x4 T = glm::mat4x4(1.0);
-    glm::mat4x4 R = glm::mat4x4(1.0);
-    glm::mat4x4 S = glm::mat4x4(1.0);
+    hierarchy.setLocal(slot, glm::mat4x4(glm::make_mat4x4(std::data(node.matrix))));
+    return;
+  }
 
-    if(!std::empty(node.translation))
-      T = glm::translate(glm::mat4x4(1.0), glm::vec3(glm::make_vec3(std::data(node.translation))));
+  if(!std::empty(node.translation))
+    hierarchy.translation[slot] = glm::vec3(glm::make_vec3(std::data(node.translation)));
 
-    if(!std::empty(node.rotation))
-      R = glm::toMat4(glm::make_quat(std::data(node.rotation)));
+  if(!std::empty(node.rotation))
+    hierarchy.rotation[slot] = glm::quat(glm::make_quat(std::data(node.rotation)));
 
-    if(!std::empty(node.scale))
-      S = glm::scale(glm::mat4x4(1.0), glm::vec3(glm::make_vec3(std::data(node.scale))));
+  if(!std::empty(node.scale))
+    hierarchy.scale[slot] = glm::vec3(glm::make_vec3(std::data(node.scale)));
 
-    if(buffer.type == node_t::type_t::camera)
-      buffer.transformMatrix_ = glm::inverse(parentNodeTransform * T * R);
-    else
-      buffer.transformMatrix_ = parentNodeTransform * T * R * S;
-  }
+  hierarchy.markDirty(slot);
 }
 
-void Scene::loadMeshVertexPositionData(mesh_buffer_t& buffer, int accessorIndex) {
-  GLuint attribIndex = glGetAttribLocation(programID, "vertexPosition");
+// One GL buffer per glTF buffer view, created on first use and shared by every accessor into it
+GLuint Scene::bufferViewBuffer(int bufferViewIndex) {
+  GLuint& id = bufferViewBuffers[bufferViewIndex];
 
-  const tn::Accessor& accessor = model.accessors[accessorIndex];
-  const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
-  const tn::Buffer& buf = model.buffers[bv.buffer];
+  if(id == 0) {
+    const tn::BufferView& bv = model.bufferViews[bufferViewIndex];
 
-  GLuint id;
-  glCreateBuffers(1, &id);
-  glBindBuffer(bv.target, id);
+    glCreateBuffers(1, &id);
+    glNamedBufferStorage(id, bv.byteLength, bufferViewData(model, bufferData, bufferViewIndex), 0);
+  }
 
-  buffer.vertexAttribute.positionBufferID = id;
+  return id;
+}
 
-  buffer.count = accessor.count;
-  glBufferStorage(bv.target, bv.byteLength, std::data(buf.data) + bv.byteOffset, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+// The accessor's offset and stride go into the binding, so the attribute itself starts at 0. Returns the buffer: the shared buffer view buffer,
+// or for a sparse accessor its own copy resolved on the CPU, uploaded once.
+GLuint Scene::bindVertexAttribute(GLuint vertexArrayID, GLuint attribIndex, int accessorIndex) {
+  const tn::Accessor& accessor = model.accessors[accessorIndex];
 
-  glVertexArrayVertexBuffer(buffer.vertexArrayID, attribIndex, buffer.vertexAttribute.positionBufferID, accessor.byteOffset, accessor.ByteStride(bv));
-  glVertexArrayAttribFormat(buffer.vertexArrayID, attribIndex, tn::GetNumComponentsInType(accessor.type), accessor.componentType, accessor.normalized, accessor.byteOffset);
+  GLuint bufferID;
+  if(!accessor.sparse.isSparse && accessor.bufferView != -1) {
+    bufferID = bufferViewBuffer(accessor.bufferView);
+    glVertexArrayVertexBuffer(vertexArrayID, attribIndex, bufferID, accessor.byteOffset, accessor.ByteStride(model.bufferViews[accessor.bufferView]));
+  } else {
+    const std::vector<unsigned char> elements = resolveAccessor(model, bufferData, accessorIndex);
 
-  glVertexArrayAttribBinding(buffer.vertexArrayID, attribIndex, attribIndex);
-  glEnableVertexArrayAttrib(buffer.vertexArrayID, attribIndex);
+    glCreateBuffers(1, &bufferID);
+    glNamedBufferStorage(bufferID, std::size(elements), std::data(elements), 0);
+    glVertexArrayVertexBuffer(vertexArrayID, attribIndex, bufferID, 0, tn::GetNumComponentsInType(accessor.type) * tn::GetComponentSizeInBytes(accessor.componentType));
+  }
 
-  if(accessor.sparse.isSparse) {
-    const tn::Accessor::Sparse& sparse = accessor.sparse;
+  if(attribIndex == jointsAttribute) // indices into the palette, not converted to float
+    glVertexArrayAttribIFormat(vertexArrayID, attribIndex, tn::GetNumComponentsInType(accessor.type), accessor.componentType, 0);
+  else
+    glVertexArrayAttribFormat(vertexArrayID, attribIndex, tn::GetNumComponentsInType(accessor.type), accessor.componentType, accessor.normalized, 0);
 
-    const tn::BufferView& indicesBufferView = model.bufferViews[sparse.indices.bufferView];
-    const tn::Buffer& indicesBuffer = model.buffers[indicesBufferView.buffer];
+  glVertexArrayAttribBinding(vertexArrayID, attribIndex, attribIndex);
+  glEnableVertexArrayAttrib(vertexArrayID, attribIndex);
 
-    const auto indices_begin = reinterpret_cast<unsigned short*>(const_cast<unsigned char*>(std::data(indicesBuffer.data)) + indicesBufferView.byteOffset + sparse.indices.byteOffset);
-    const auto indices_end = indices_begin + sparse.count;
-    const std::span<unsigned short> indices(indices_begin, indices_end);
+  return bufferID;
+}
 
-    const tn::BufferView& valuesBufferView = model.bufferViews[sparse.values.bufferView];
-    const tn::Buffer& valuesBuffer = model.buffers[valuesBufferView.buffer];
+// translation, rotation and scale per instance, any of them may be missing
+void Scene::loadNodeInstances(node_t& buffer, const gpu_instancing_t& instancing) {
+  std::vector<float> translations, rotations, scales;
+  if(instancing.translation != -1)
+    appendAccessor(model, bufferData, instancing.translation, translations);
+  if(instancing.rotation != -1)
+    appendAccessor(model, bufferData, instancing.rotation, rotations);
+  if(instancing.scale != -1)
+    appendAccessor(model, bufferData, instancing.scale, scales);
+
+  const std::size_t count = std::max({std::size(translations) / 3, std::size(rotations) / 4, std::size(scales) / 3});
+  buffer.instances.resize(count, glm::mat4x4(1.0f));
+
+  for(std::size_t i = 0; i < count; ++i) {
+    glm::mat4x4& instance = buffer.instances[i];
+
+    if(i < std::size(translations) / 3)
+      instance = glm::translate(instance, glm::make_vec3(std::data(translations) + 3 * i));
+    if(i < std::size(rotations) / 4)
+      instance = instance * glm::mat4_cast(glm::make_quat(std::data(rotations) + 4 * i));
+    if(i < std::size(scales) / 3)
+      instance = glm::scale(instance, glm::make_vec3(std::data(scales) + 3 * i));
+  }
+}
 
-    const auto values_begin = reinterpret_cast<glm::vec3*>(const_cast<unsigned char*>(std::data(valuesBuffer.data)) + valuesBufferView.byteOffset + sparse.values.byteOffset);
-    const auto values_end = values_begin + sparse.count;
-    const std::span<glm::vec3> values(values_begin, values_end);
+void Scene::loadMeshVertexPositionData(primitive_buffer_t& buffer, int accessorIndex) {
+  buffer.count = model.accessors[accessorIndex].count;
+  buffer.vertexAttribute.positionBufferID = bindVertexAttribute(buffer.vertexArrayID, positionAttribute, accessorIndex);
 
-    glm::vec3* const ptr = reinterpret_cast<glm::vec3*>(glMapNamedBuffer(id, GL_READ_WRITE));
-    for(int i = 0; i < sparse.count; ++i)
-      *(ptr + indices[i]) = values[i];
-    glUnmapNamedBuffer(id);
-  }
+  assert(glGetError() == GL_NO_ERROR);
+}
+
+void Scene::loadMeshVertexNormalData(primitive_buffer_t& buffer, int accessorIndex) {
+  buffer.vertexAttribute.normalBufferID = bindVertexAttribute(buffer.vertexArrayID, normalAttribute, accessorIndex);
 
   assert(glGetError() == GL_NO_ERROR);
 }
 
-void Scene::loadMeshVertexNormalData(mesh_buffer_t& buffer, int accessorIndex) {
-  GLuint attribIndex = glGetAttribLocation(programID, "vertexNormal");
+void Scene::loadMeshTangentialDirectionData(primitive_buffer_t& mesh_buffer, int accessorIndex) {
+  mesh_buffer.vertexAttribute.tangentBufferID = bindVertexAttribute(mesh_buffer.vertexArrayID, tangentAttribute, accessorIndex);
 
-  const tn::Accessor accessor = model.accessors[accessorIndex];
-  const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
-  const tn::Buffer& buf = model.buffers[bv.buffer];
+  assert(glGetError() == GL_NO_ERROR);
+}
 
-  GLuint id;
-  glCreateBuffers(1, &id);
-  glBindBuffer(bv.target, id);
+// JOINTS_0 unsigned byte or short, WEIGHTS_0 float or normalized unsigned byte or short
+void Scene::loadMeshSkinData(primitive_buffer_t& buffer, int jointsAccessorIndex, int weightsAccessorIndex) {
+  buffer.vertexAttribute.jointsBufferID = bindVertexAttribute(buffer.vertexArrayID, jointsAttribute, jointsAccessorIndex);
+  buffer.vertexAttribute.weightsBufferID = bindVertexAttribute(buffer.vertexArrayID, weightsAttribute, weightsAccessorIndex);
 
-  buffer.vertexAttribute.normalBufferID = id;
+  assert(glGetError() == GL_NO_ERROR);
+}
 
-  glBufferStorage(bv.target, bv.byteLength, std::data(buf.data) + bv.byteOffset, GL_MAP_READ_BIT);
+// Deltas as vec4 in morph_targets_t order, an attribute some targets lack is zero in those
+void Scene::loadMorphTargets(primitive_buffer_t& buffer, const tn::Primitive& primitive) {
+  const auto position = primitive.attributes.find("POSITION");
+  if(position == std::end(primitive.attributes))
+    return;
+
+  constexpr std::array<std::pair<const char*, vertexStream_t>, 3> attributes = {{{"POSITION", positionStream}, {"NORMAL", normalStream}, {"TANGENT", tangentStream}}};
+
+  morph_targets_t& morph = buffer.morphTargets;
+  morph.firstDelta = std::size(morphDeltas);
+  morph.targetCount = std::size(primitive.targets);
+  morph.vertexCount = model.accessors[position->second].count;
+
+  for(const std::map<std::string, int>& target : primitive.targets)
+    for(const auto& [name, stream] : attributes)
+      if(target.contains(name))
+        morph.attributes |= stream;
+
+  std::vector<float> deltas;
+  for(const std::map<std::string, int>& target : primitive.targets) {
+    for(const auto& [name, stream] : attributes) {
+      if(!(morph.attributes & stream))
+        continue;
+
+      const std::size_t first = std::size(morphDeltas);
+      morphDeltas.resize(first + morph.vertexCount, glm::vec4(0.0f));
+
+      const auto accessor = target.find(name);
+      if(accessor == std::end(target))
+        continue;
+
+      deltas.clear();
+      appendAccessor(model, bufferData, accessor->second, deltas); // vec3, TANGENT deltas too
+      for(std::uint32_t v = 0; v < morph.vertexCount && 3 * v + 2 < std::size(deltas); ++v)
+        morphDeltas[first + v] = glm::vec4(deltas[3 * v], deltas[3 * v + 1], deltas[3 * v + 2], 0.0f);
+    }
+  }
+}
 
-  glVertexArrayVertexBuffer(buffer.vertexArrayID, attribIndex, buffer.vertexAttribute.normalBufferID, accessor.byteOffset, accessor.ByteStride(bv));
-  glVertexArrayAttribFormat(buffer.vertexArrayID, attribIndex, tn::GetNumComponentsInType(accessor.type), accessor.componentType, accessor.normalized, accessor.byteOffset);
+// node weights override the mesh's default weights, both are optional
+void Scene::loadMorphWeights(node_t& buffer, const tn::Node& node) {
+  const tn::Mesh& mesh = model.meshes[node.mesh];
 
-  glVertexArrayAttribBinding(buffer.vertexArrayID, attribIndex, attribIndex);
-  glEnableVertexArrayAttrib(buffer.vertexArrayID, attribIndex);
+  std::uint32_t count = 0;
+  for(const tn::Primitive& primitive : mesh.primitives)
+    count = std::max<std::uint32_t>(count, std::size(primitive.targets));
+  if(count == 0)
+    return;
 
-  assert(glGetError() == GL_NO_ERROR);
+  buffer.morph.first = std::size(morphWeights);
+  buffer.morph.count = count;
+
+  const std::vector<double>& weights = std::size(node.weights) == count ? node.weights : mesh.weights;
+  for(std::uint32_t i = 0; i < count; ++i)
+    morphWeights.push_back(i < std::size(weights) ? static_cast<float>(weights[i]) : 0.0f);
 }
 
-void Scene::loadMeshTangentialDirectionData(mesh_buffer_t& mesh_buffer, int accessorIndex) {
-  GLuint attribIndex = glGetAttribLocation(programID, "vertexTangent");
+void Scene::loadMeshTextureCoordinateData(primitive_buffer_t& buffer, int accessorIndex, const std::string& TEXCOORD_n) {
+  const GLuint attribIndex = texcoordAttribute + std::stoi(TEXCOORD_n.substr(std::size("TEXCOORD_") - 1));
 
-  const tn::Accessor accessor = model.accessors[accessorIndex];
-  const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
-  const tn::Buffer& buf = model.buffers[bv.buffer];
+  buffer.vertexAttribute.textureCoordinateBufferIDs[TEXCOORD_n] = bindVertexAttribute(buffer.vertexArrayID, attribIndex, accessorIndex);
 
-  GLuint id;
-  glCreateBuffers(1, &id);
-  glBindBuffer(bv.target, id);
+  assert(glGetError() == GL_NO_ERROR);
+}
 
-  mesh_buffer.vertexAttribute.tangentBufferID = id;
+void Scene::loadMeshDrawIndices(primitive_buffer_t& buffer, int accessorIndex) {
+  const tn::Accessor& accessor = model.accessors[accessorIndex];
 
-  glBufferStorage(bv.target, bv.byteLength, std::data(buf.data) + bv.byteOffset, GL_MAP_READ_BIT);
+  if(accessor.sparse.isSparse || accessor.bufferView == -1) { // resolved into an element buffer of its own
+    loadMeshLodIndices(buffer, accessorIndex, {});
+    return;
+  }
 
-  glVertexArrayVertexBuffer(mesh_buffer.vertexArrayID, attribIndex, mesh_buffer.vertexAttribute.tangentBufferID, accessor.byteOffset, accessor.ByteStride(bv));
-  glVertexArrayAttribFormat(mesh_buffer.vertexArrayID, attribIndex, tn::GetNumComponentsInType(accessor.type), accessor.componentType, accessor.normalized, accessor.byteOffset);
+  buffer.element.elementBufferID = bufferViewBuffer(accessor.bufferView);
+  glVertexArrayElementBuffer(buffer.vertexArrayID, buffer.element.elementBufferID);
 
-  glVertexArrayAttribBinding(mesh_buffer.vertexArrayID, attribIndex, attribIndex);
-  glEnableVertexArrayAttrib(mesh_buffer.vertexArrayID, attribIndex);
+  buffer.element.offset = accessor.byteOffset;
+  buffer.element.componentType = accessor.componentType;
+  buffer.element.count = accessor.count;
+
+  assert(glGetError() == GL_NO_ERROR);
 }
 
-void Scene::loadMeshTextureCoordinateData(mesh_buffer_t& buffer, int accessorIndex, const std::string& TEXCOORD_n) {
-  GLuint attribIndex = glGetAttribLocation(programID, TEXCOORD_n.c_str());
+void Scene::loadMeshLodIndices(primitive_buffer_t& buffer, int accessorIndex, const lod_chain_t& lods) {
+  std::vector<std::uint32_t> indices;
+  appendIndices(model, bufferData, accessorIndex, indices);
 
-  const tn::Accessor accessor = model.accessors[accessorIndex];
-  const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
-  const tn::Buffer& buf = model.buffers[bv.buffer];
+  loadElementIndices(buffer, std::move(indices), lods);
+}
 
-  glBindVertexArray(buffer.vertexArrayID);
+// interleaved like the arenas, in buffer.vertexFormat, only TEXCOORD_0 of the texture coordinates
+void Scene::loadMeshStreams(primitive_buffer_t& buffer, const vertex_streams_t& streams, const lod_chain_t& lods) {
+  std::vector<unsigned char> vertices;
+  appendVertices(vertices, streams, buffer.vertexFormat, buffer.quantization);
 
   GLuint id;
   glCreateBuffers(1, &id);
-  glBindBuffer(bv.target, id);
+  glNamedBufferStorage(id, std::size(vertices), std::data(vertices), 0);
 
-  buffer.material.textureUV[TEXCOORD_n] = id;
+  buffer.vertexAttribute.positionBufferID = id; // all streams
+  buffer.count = streams.vertexCount();
 
-  glBufferStorage(bv.target, bv.byteLength, std::data(buf.data) + bv.byteOffset, GL_MAP_READ_BIT);
+  glVertexArrayVertexBuffer(buffer.vertexArrayID, 0, id, 0, vertexStride(buffer.vertexFormat));
+  setVertexFormat(buffer.vertexArrayID, buffer.vertexFormat, 0);
 
-  glVertexArrayVertexBuffer(buffer.vertexArrayID, attribIndex, id, accessor.byteOffset, accessor.ByteStride(bv));
-  glVertexArrayAttribFormat(buffer.vertexArrayID, attribIndex, tn::GetNumComponentsInType(accessor.type), accessor.componentType, accessor.normalized, 0);
-
-  glVertexArrayAttribBinding(buffer.vertexArrayID, attribIndex, attribIndex);
-  glEnableVertexArrayAttrib(buffer.vertexArrayID, attribIndex);
-
-  assert(glGetError() == GL_NO_ERROR);
+  loadElementIndices(buffer, streams.indices, lods);
 }
 
-void Scene::loadMeshDrawIndices(mesh_buffer_t& buffer, int accessorIndex) {
-  const tn::Accessor& accessor = model.accessors[accessorIndex];
-  const tn::BufferView& bv = model.bufferViews[accessor.bufferView];
-  const tn::Buffer& buf = model.buffers[bv.buffer];
-
-  glBindVertexArray(buffer.vertexArrayID);
+// Every level in one element buffer, the full detail indices first. 16 bit when every index fits.
+void Scene::loadElementIndices(primitive_buffer_t& buffer, std::vector<std::uint32_t> indices, const lod_chain_t& lods) {
+  if(!std::empty(lods)) {
+    buffer.lods.push_back({0, static_cast<std::uint32_t>(std::size(indices)), 0.0f});
+    for(const lod_level_t& level : lods) {
+      buffer.lods.push_back({static_cast<std::uint32_t>(std::size(indices)), static_cast<std::uint32_t>(std::size(level.indices)), level.error});
+      indices.insert(std::end(indices), std::begin(level.indices), std::end(level.indices));
+    }
+  }
 
   GLuint id;
   glCreateBuffers(1, &id);
-  glBindBuffer(bv.target, id);
+
+  if(std::empty(indices) || std::ranges::max(indices) <= 0xFFFF) {
+    const std::vector<std::uint16_t> narrowed(std::begin(indices), std::end(indices));
+    glNamedBufferStorage(id, std::size(narrowed) * sizeof(std::uint16_t), std::data(narrowed), 0);
+    buffer.element.componentType = GL_UNSIGNED_SHORT;
+  } else {
+    glNamedBufferStorage(id, std::size(indices) * sizeof(std::uint32_t), std::data(indices), 0);
+    buffer.element.componentType = GL_UNSIGNED_INT;
+  }
 
   buffer.element.elementBufferID = id;
   glVertexArrayElementBuffer(buffer.vertexArrayID, id);
 
-  buffer.element.offset = accessor.byteOffset;
+  buffer.element.offset = 0;
+  buffer.element.count = std::empty(lods) ? std::size(indices) : buffer.lods[0].indexCount;
 
-  glBufferStorage(bv.target, bv.byteLength, std::data(buf.data) + bv.byteOffset, GL_MAP_READ_BIT);
+  assert(glGetError() == GL_NO_ERROR);
+}
 
-  buffer.element.componentType = accessor.componentType;
-  buffer.element.count = accessor.count;
+void Scene::loadMaterials() {
+  materials.resize(std::size(model.materials) + 1); // the last one is the glTF default material
+
+  for(std::size_t i = 0; i < std::size(model.materials); ++i)
+    loadMaterial(materials[i], model.materials[i]);
+
+  std::vector<gpu_material_t> factors;
+  factors.reserve(std::size(materials));
+
+  for(material_t& material : materials) {
+    material.textureSet = textureSets.try_emplace(std::pair(material.textures, material.samplers), static_cast<std::uint32_t>(std::size(textureSets))).first->second;
+    factors.push_back(material.factors);
+  }
+
+  glCreateBuffers(1, &materialBufferID);
+  glNamedBufferStorage(materialBufferID, std::size(factors) * sizeof(gpu_material_t), std::data(factors), 0);
 
   assert(glGetError() == GL_NO_ERROR);
 }
 
-void Scene::loadMeshMaterial(mesh_buffer_t& buffer, int materialIndex) {
-  const tn::Material& material = model.materials[materialIndex];
+void Scene::loadMaterial(material_t& material, const tn::Material& gltfMaterial) {
+  material.doubleSided = gltfMaterial.doubleSided;
+  material.alphaCutoff = gltfMaterial.alphaCutoff;
 
-  buffer.material.emissiveFactor.r = material.emissiveFactor[0];
-  buffer.material.emissiveFactor.g = material.emissiveFactor[1];
-  buffer.material.emissiveFactor.b = material.emissiveFactor[2];
+  if(gltfMaterial.alphaMode == "MASK")
+    material.alphaMode = material_t::alphaMode_t::mask;
+  else if(gltfMaterial.alphaMode == "BLEND")
+    material.alphaMode = material_t::alphaMode_t::blend;
 
-  const tn::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+  material.factors.emissiveFactor = glm::vec3(glm::make_vec3(std::data(gltfMaterial.emissiveFactor)));
 
-  buffer.material.pbr.roughnessFactor = pbr.roughnessFactor;
-  buffer.material.pbr.metallicFactor = pbr.metallicFactor;
+  const tn::PbrMetallicRoughness& pbr = gltfMaterial.pbrMetallicRoughness;
 
-  buffer.material.pbr.baseColorFactor.r = pbr.baseColorFactor[0];
-  buffer.material.pbr.baseColorFactor.g = pbr.baseColorFactor[1];
-  buffer.material.pbr.baseColorFactor.b = pbr.baseColorFactor[2];
-  buffer.material.pbr.baseColorFactor.a = pbr.baseColorFactor[3];
+  material.factors.baseColorFactor = glm::vec4(glm::make_vec4(std::data(pbr.baseColorFactor)));
+  material.factors.roughnessFactor = pbr.roughnessFactor;
+  material.factors.metallicFactor = pbr.metallicFactor;
 
   if(const tn::TextureInfo& baseColorTexture = pbr.baseColorTexture; baseColorTexture.index != -1) {
-    loadTexture(buffer, baseColorTexture.index, baseColorTexture.texCoord, mesh_buffer_t::material_properties_t::textureKind::baseColorTexture);
+    loadTexture(material, baseColorTexture.index, material_t::textureKind::baseColorTexture);
   }
 
   if(const tn::TextureInfo& metallicRoughnessTexture = pbr.metallicRoughnessTexture; metallicRoughnessTexture.index != -1) {
-    loadTexture(buffer, metallicRoughnessTexture.index, metallicRoughnessTexture.texCoord, mesh_buffer_t::material_properties_t::textureKind::metallicRoughnessTexture);
+    loadTexture(material, metallicRoughnessTexture.index, material_t::textureKind::metallicRoughnessTexture);
   }
 
-  if(const tn::NormalTextureInfo& normalTexture = material.normalTexture; normalTexture.index != -1) {
+  if(const tn::NormalTextureInfo& normalTexture = gltfMaterial.normalTexture; normalTexture.index != -1) {
+    loadTexture(material, normalTexture.index, material_t::textureKind::normalTexture);
+    material.factors.normalScale = normalTexture.scale;
   }
 
-  if(const tn::OcclusionTextureInfo& occlusionTexture = material.occlusionTexture; occlusionTexture.index != -1) {
+  if(const tn::OcclusionTextureInfo& occlusionTexture = gltfMaterial.occlusionTexture; occlusionTexture.index != -1) {
+    loadTexture(material, occlusionTexture.index, material_t::textureKind::occlusionTexture);
+    material.factors.occlusionStrength = occlusionTexture.strength;
   }
 
-  if(const tn::TextureInfo& emissiveTexture = material.emissiveTexture; emissiveTexture.index != -1) {
+  if(const tn::TextureInfo& emissiveTexture = gltfMaterial.emissiveTexture; emissiveTexture.index != -1) {
+    loadTexture(material, emissiveTexture.index, material_t::textureKind::emissionTexture);
   }
-
 }
 
-void Scene::loadTexture(mesh_buffer_t& buffer, int textureIndex, int texCoord_n, mesh_buffer_t::material_properties_t::textureKind kind) {
+void Scene::loadTexture(material_t& material, int textureIndex, material_t::textureKind kind) {
   const tn::Texture& texture = model.textures[textureIndex];
-  const tn::Sampler& sampler = model.samplers[texture.sampler];
-  const tn::Image& im = model.images[texture.source];
 
-  GLuint id;
-  glCreateTextures(GL_TEXTURE_2D, 1, &id);
-  assert(glIsTexture(id));
+  const texture_key_t key = {texture.source, kind == material_t::textureKind::baseColorTexture};
 
-  glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
-  glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
-  glTextureParameteri(id, GL_TEXTURE_WRAP_S, sampler.wrapS);
-  glTextureParameteri(id, GL_TEXTURE_WRAP_T, sampler.wrapT);
+  GLuint id = textureCache.acquire(key);
+  if(id == 0) {
+    id = createTexture(key);
+    textureCache.insert(key, id);
+  }
+
+  material.textures[std::to_underlying(kind)] = id;
 
-  const unsigned char* pixels_data = nullptr;
-  if(im.bufferView != -1) {
-    const tn::BufferView& bv = model.bufferViews[im.bufferView];
-    const tn::Buffer& buf = model.buffers[bv.buffer];
-    pixels_data = std::data(buf.data) + bv.byteOffset;
+  if(texture.sampler != -1) {
+    const tn::Sampler& sampler = model.samplers[texture.sampler];
+    material.samplers[std::to_underlying(kind)] = samplerCache.get(sampler.minFilter, sampler.magFilter, sampler.wrapS, sampler.wrapT);
   } else {
-    pixels_data = std::data(im.image);
+    material.samplers[std::to_underlying(kind)] = samplerCache.get(-1, -1, GL_REPEAT, GL_REPEAT);
   }
 
-  GLenum format = 0;
-  switch(im.component) {
-  case 1: format = GL_RED; break;
-  case 2: format = GL_RG; break;
-  case 3: format = GL_RGB; break;
-  case 4: format = GL_RGBA; break;
-  }
-  assert(format != 0);
+  material.factors.textureFlags |= 1u << std::to_underlying(kind);
+}
 
-  GLenum internalFormat = 0;
-  switch(kind) {
-    using enum mesh_buffer_t::material_properties_t::textureKind;
-  case normalTexture:
-    internalFormat = im.component == 4 ? GL_RGBA8 : GL_RGB8;
-    buffer.material.normalTexture.textureID = id;
-    break;
+GLuint Scene::createTexture(const texture_key_t& key) const {
+  const tn::Image& im = model.images[key.image];
+
+  GLuint id;
+  glCreateTextures(GL_TEXTURE_2D, 1, &id);
+  assert(glIsTexture(id));
+
+  const unsigned char* pixels_data = std::data(imageData[key.image]); // decoded, also for images stored in a buffer view
 
-  case occlusionTexture:
-    internalFormat = im.component == 4 ? GL_RGBA8 : im.component == 3 ? GL_RGB8 : im.component == 2 ? GL_RG8 : GL_R8;
-    buffer.material.occlusionTexture.textureID = id;
+  GLenum format = 0;
+  GLenum internalFormat = 0;
+  switch(im.component) {
+  case 1:
+    format = GL_RED;
+    internalFormat = GL_R8;
     break;
 
-  case emissionTexture:
-    internalFormat = im.component == 4 ? GL_RGBA8 : GL_RGB8;
-    buffer.material.emissiveTexture.textureID = id;
+  case 2:
+    format = GL_RG;
+    internalFormat = GL_RG8;
     break;
 
-  case baseColorTexture:
-    internalFormat = im.component == 4 ? GL_SRGB8_ALPHA8 : GL_SRGB8;
-    buffer.material.pbr.baseColorTexture.textureID = id;
+  case 3:
+    format = GL_RGB;
+    internalFormat = key.sRGB ? GL_SRGB8 : GL_RGB8;
     break;
 
-  case metallicRoughnessTexture:
-    internalFormat = im.component == 4 ? GL_RGBA8 : GL_RGB8;
-    buffer.material.pbr.metallicRoughnessTexture.textureID = id;
+  case 4:
+    format = GL_RGBA;
+    internalFormat = key.sRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
     break;
-  };
-  assert(internalFormat != 0);
+  }
+  assert(format != 0 && internalFormat != 0);
 
   std::print("im.component: {}\nim.bits: {}\nim.width: {}\nim.height: {}\nim.mimeType: {}\n", im.component, im.bits, im.width, im.height, im.mimeType);
 
-  glTextureStorage2D(id, 1, internalFormat, im.width, im.height);
+  const GLsizei levels = std::bit_width(static_cast<unsigned>(std::max(im.width, im.height))); // full chain down to 1x1
+
+  glTextureStorage2D(id, levels, internalFormat, im.width, im.height);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // decoded rows are tightly packed
   glTextureSubImage2D(id, 0, 0, 0, im.width, im.height, format, im.pixel_type, pixels_data);
 
+  if(levels > 1)
+    glGenerateTextureMipmap(id);
+
   assert(glGetError() == GL_NO_ERROR);
-};
+
+  return id;
+}
@@ -3,59 +3,242 @@
 #include <GL/glew.h>
 
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
 
 #include <tiny_gltf.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <utility>
 #include <vector>
 #include <filesystem>
+#include <stop_token>
+#include <thread>
 
 #include "Node.h"
+#include "Material.h"
+#include "TextureCache.h"
+#include "SamplerCache.h"
 #include "Camera.h"
+#include "Animation.h"
+#include "Bounds.h"
+#include "BoundingVolumeHierarchy.h"
+#include "TransformHierarchy.h"
+#include "Skinning.h"
+#include "GeometryArena.h"
+#include "MappedFile.h"
+#include "SceneCache.h"
+
+namespace util {
+class ThreadPool;
+}
 
 namespace tn = tinygltf;
 
 struct Scene {
   tn::Model model;
-  std::unordered_map<int, node_t> buffers;
+
+  std::vector<node_t> buffers;       // indexed by hierarchy slot
+  std::vector<mesh_buffer_t> meshes; // per glTF mesh, uploaded once by the first node that references it
+  std::vector<int> nodeSlots;  // glTF node index to hierarchy slot, -1 if the node isn't in any scene
+  transform_hierarchy_t hierarchy;
+
+  std::vector<aabb_t> localBounds; // per slot, from the POSITION min and max of the node's mesh and its instances, empty for nodes without one
+  bounds_soa_t worldBounds;        // per slot, kept in step with hierarchy.world
+  BoundingVolumeHierarchy bvh;     // over the slots with bounds, refit with worldBounds
 
   std::vector<Camera> cameras;
 
-  GLuint programID;
+  std::vector<skin_t> skins;       // per glTF skin
+  joint_palette_t jointPalette;    // joints of all skins, recomputed after every hierarchy update
+  GLuint jointPaletteBufferID = 0; // jointPalette.matrices, std430
+
+  std::vector<float> morphWeights;                // per morphed node, its mesh's target count of weights side by side, written by animation
+  std::vector<morph_weight_t> activeMorphWeights; // the non-zero morphWeights of every node, rebuilt after animation
+  GLuint morphDeltaBufferID = 0;                  // every primitive's morph target deltas, std430 vec4
+  GLuint morphWeightBufferID = 0;                 // activeMorphWeights, std430
+
+  std::vector<material_t> materials; // one per glTF material, the default material last
+  GLuint materialBufferID = 0;       // materials[i].factors, std430
+
+  TextureCache textureCache;
+  SamplerCache samplerCache;
+
+  std::vector<animation_clip_t> animations;
+
+  enum class animation_mode_t { serial, parallel };
+  animation_mode_t animationMode = animation_mode_t::serial; // default
+
+  // merged: triangle primitives share per vertex format arenas and are drawn with glMultiDrawElementsIndirect
+  enum class geometry_mode_t { separate, merged };
+  geometry_mode_t geometryMode = geometry_mode_t::separate; // default, takes effect on the next load
+
+  GeometryArenas arenas;
+
+  bool useSceneCache = true; // default, read <file>.scenecache when it matches the source, bake it otherwise
+
+  bool optimizeMeshes = true; // default, takes effect on the next load. Reorders indexed triangle primitives for the vertex cache, overdraw and vertex fetch
+
+  // takes effect on the next load, for the primitives uploaded from vertex streams: every arena primitive, optimized ones in separate mode
+  bool quantizeVertices = false; // default
+
+  // reading and parsing run on the loader thread, parsed and failed wait for finishLoad() on the render thread
+  enum class load_stage_t { idle, reading, parsing, decoding, optimizing, baking, parsed, failed };
 
   bool load(const std::filesystem::path& modelglTFfile);
   void unload();
 
-  void setProgramID(GLuint programID);
+  void loadAsync(const std::filesystem::path& modelglTFfile);
+  bool finishLoad(); // GL uploads of a parsed scene, false if parsing failed
+  void cancelLoad();
+
+  load_stage_t loadStage() const {
+    return stage;
+  }
+
+  std::uint32_t decodedImageCount() const {
+    return decodedImages;
+  }
+
+  std::uint32_t loadImageCount() const {
+    return imageCount;
+  }
+
+  // Image bytes recorded by the tinygltf image loader, empty when the image lives in a buffer view
+  struct encoded_image_t {
+    int imageIndex;
+    std::vector<unsigned char> bytes;
+  };
+
+  void setThreadPool(util::ThreadPool* threadPool);
 
   tn::Model& getModel() {
     return model;
   }
 
-  std::unordered_map<int, node_t>& getBuffers() {
+  std::vector<node_t>& getBuffers() {
     return buffers;
   }
 
-  const std::unordered_map<int, node_t>& getBuffers() const {
+  const std::vector<node_t>& getBuffers() const {
     return buffers;
   }
 
+  std::size_t primitiveCount() const { // of mesh nodes
+    return primitives;
+  }
+
+  std::size_t instanceCount() const { // primitives times the instances of their nodes
+    return instances;
+  }
+
+  const std::vector<material_t>& getMaterials() const {
+    return materials;
+  }
+
+  const glm::mat4x4& worldMatrix(int slot) const {
+    return hierarchy.world[slot];
+  }
+
+  glm::mat4x4 viewMatrix(int slot) const {
+    return glm::inverse(hierarchy.world[slot]);
+  }
+
   void animate(float currentTime);
 
 private:
-  void visitScene(const tn::Scene& scene);
-  void visitNode(const int nodeIndex, const glm::mat4x4& parentNodeTransform);
-  void visitNodeMesh(const tn::Mesh& mesh, mesh_buffer_t& mesh_buffer);
-  void visitMeshPrimitive(mesh_buffer_t& mesh_buffer, const tn::Primitive& primitive);
+  // Channels grouped by the node they animate, in clip then channel order. Each node is written by exactly one task.
+  struct channel_ref_t {
+    std::uint32_t clip;
+    std::uint32_t channel;
+  };
+
+  struct animated_node_t {
+    int slot;
+    std::uint32_t firstChannel; // into animatedChannels
+    std::uint32_t channelCount;
+  };
 
-  void loadNodeTransformData(const tn::Node& node, node_t& buffer, const glm::mat4x4& parentNodeTransform);
-  void loadMeshVertexPositionData(mesh_buffer_t& buffer, int accessorIndex);
-  void loadMeshVertexNormalData(mesh_buffer_t& buffer, int accessorIndex);
-  void loadMeshTextureCoordinateData(mesh_buffer_t& buffer, int accessorIndex, const std::string& TEXCOORD_n);
-  void loadMeshDrawIndices(mesh_buffer_t& buffer, int accessorIndex);
-  void loadMeshTangentialDirectionData(mesh_buffer_t& buffer, int accessorIndex);
+  std::vector<animated_node_t> animatedNodes;
+  std::vector<channel_ref_t> animatedChannels;
+  std::vector<float> clipTimes;
 
-  void loadMeshMaterial(mesh_buffer_t& buffer, int materialIndex);
+  std::map<std::pair<decltype(material_t::textures), decltype(material_t::samplers)>, std::uint32_t> textureSets;
 
-  void loadTexture(mesh_buffer_t& buffer, int textureIndex, int texCoord_n, mesh_buffer_t::material_properties_t::textureKind kind);
+  util::ThreadPool* threadPool = nullptr;
+
+  std::size_t primitives = 0;
+  std::size_t instances = 0;
+
+  util::MappedFile mappedFile;                             // the .glb while its BIN chunk is in use
+  std::vector<std::span<const unsigned char>> bufferData; // per glTF buffer, into mappedFile, sceneCache or tn::Buffer::data
+  std::vector<std::span<const unsigned char>> imageData;  // decoded pixels per glTF image, into sceneCache or tn::Image::image
+  scene_cache_t sceneCache;
+
+  std::vector<GLuint> bufferViewBuffers; // per glTF buffer view, 0 until an accessor into it is uploaded
+
+  std::vector<int> skinnedSlots;      // mesh nodes with a skin, their world bounds follow the joints
+  std::vector<int> morphedSlots;      // mesh nodes with morph targets
+  std::vector<glm::vec4> morphDeltas; // of every primitive, released after upload
+
+  std::vector<gpu_instancing_t> nodeInstancing;           // per glTF node, read by parse() or from the scene cache
+  std::vector<std::vector<vertex_streams_t>> meshStreams; // [mesh][primitive], optimized vertex data, empty for primitives uploaded as exported
+  std::vector<std::vector<lod_chain_t>> meshLods;         // [mesh][primitive], both built by parse() or read from the scene cache
+
+  std::jthread loader;
+  std::atomic<load_stage_t> stage = load_stage_t::idle;
+  std::atomic<std::uint32_t> decodedImages = 0;
+  std::atomic<std::uint32_t> imageCount = 0;
+
+  bool parse(const std::filesystem::path& modelglTFFile, std::stop_token stop); // CPU only, no GL calls
+  bool decodeImages(std::span<const encoded_image_t> encodedImages, std::stop_token stop); // on the thread pool
+  void optimizeMeshGeometry(std::stop_token stop);                                         // on the thread pool
+  void loadCameras();
+  void loadInstancing();
+  void loadSkins();
+  void upload();
+
+  void updateWorldBounds();  // of the slots whose world matrix changed in the last hierarchy.update(), and of the skinned ones
+  void updateSkins();        // jointPalette from hierarchy.world, uploaded
+  void updateMorphWeights(); // activeMorphWeights from morphWeights, uploaded
+
+  void groupAnimationChannels();
+  void animateNode(const animated_node_t& animatedNode);
+
+  void visitScene(const tn::Scene& scene);
+  int visitNode(const int nodeIndex, const int parentSlot);
+  void visitMesh(int meshIndex);
+  void visitMeshPrimitive(primitive_buffer_t& primitive_buffer, const tn::Primitive& primitive, const vertex_streams_t& streams, const lod_chain_t& lods,
+                          const vertex_quantization_t& quantization);
+  aabb_t meshBounds(const tn::Mesh& mesh) const;
+
+  vertex_streams_t readVertexStreams(const tn::Primitive& primitive) const;
+  void uploadGeometryArenas();
+
+  void loadNodeTransformData(const tn::Node& node, int slot);
+  void loadNodeInstances(node_t& buffer, const gpu_instancing_t& instancing);
+  GLuint bufferViewBuffer(int bufferViewIndex);
+  GLuint bindVertexAttribute(GLuint vertexArrayID, GLuint attribIndex, int accessorIndex);
+  void loadMeshVertexPositionData(primitive_buffer_t& buffer, int accessorIndex);
+  void loadMeshVertexNormalData(primitive_buffer_t& buffer, int accessorIndex);
+  void loadMeshTextureCoordinateData(primitive_buffer_t& buffer, int accessorIndex, const std::string& TEXCOORD_n);
+  void loadMeshDrawIndices(primitive_buffer_t& buffer, int accessorIndex);
+  void loadMeshLodIndices(primitive_buffer_t& buffer, int accessorIndex, const lod_chain_t& lods);
+  void loadMeshStreams(primitive_buffer_t& buffer, const vertex_streams_t& streams, const lod_chain_t& lods);
+  void loadElementIndices(primitive_buffer_t& buffer, std::vector<std::uint32_t> indices, const lod_chain_t& lods);
+  void loadMeshTangentialDirectionData(primitive_buffer_t& buffer, int accessorIndex);
+  void loadMeshSkinData(primitive_buffer_t& buffer, int jointsAccessorIndex, int weightsAccessorIndex);
+  void loadMorphTargets(primitive_buffer_t& buffer, const tn::Primitive& primitive);
+  void loadMorphWeights(node_t& buffer, const tn::Node& node);
+
+  void loadMaterials();
+  void loadMaterial(material_t& material, const tn::Material& gltfMaterial);
+
+  void loadTexture(material_t& material, int textureIndex, material_t::textureKind kind);
+  GLuint createTexture(const texture_key_t& key) const;
 };
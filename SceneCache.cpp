@@ -0,0 +1,447 @@
+#include <tiny_gltf.h>
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <print>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "SceneCache.h"
+
+namespace {
+
+constexpr std::uint32_t cacheMagic = 0x4E435356; // "VSCN"
+constexpr std::uint32_t cacheVersion = 5;        // bump whenever anything serialized below changes
+constexpr std::size_t blobAlignment = 16;
+
+struct writer_t {
+  static constexpr bool reading = false;
+
+  std::ofstream out;
+  std::uint64_t offset = 0;
+
+  void raw(const void* data, std::size_t size) {
+    out.write(static_cast<const char*>(data), size);
+    offset += size;
+  }
+
+  std::size_t count(std::size_t n) {
+    const std::uint64_t n64 = n;
+    raw(&n64, sizeof(n64));
+    return n;
+  }
+
+  void blob(std::span<const unsigned char>& bytes) {
+    count(std::size(bytes));
+
+    constexpr std::array<char, blobAlignment> zeros{};
+    raw(std::data(zeros), (blobAlignment - offset % blobAlignment) % blobAlignment);
+    raw(std::data(bytes), std::size(bytes));
+  }
+};
+
+struct reader_t {
+  static constexpr bool reading = true;
+
+  std::span<const unsigned char> bytes;
+  std::size_t offset = 0;
+  bool ok = true;
+
+  void raw(void* data, std::size_t size) {
+    if(!ok || std::size(bytes) - offset < size) {
+      ok = false;
+      return;
+    }
+
+    std::memcpy(data, std::data(bytes) + offset, size);
+    offset += size;
+  }
+
+  std::size_t count(std::size_t) {
+    std::uint64_t n = 0;
+    raw(&n, sizeof(n));
+    return ok && n <= std::size(bytes) ? n : (ok = false, 0); // no element is smaller than a byte
+  }
+
+  void blob(std::span<const unsigned char>& out) {
+    const std::size_t size = count(0);
+
+    offset += (blobAlignment - offset % blobAlignment) % blobAlignment;
+    if(!ok || offset > std::size(bytes) || std::size(bytes) - offset < size) {
+      ok = false;
+      return;
+    }
+
+    out = bytes.subspan(offset, size);
+    offset += size;
+  }
+};
+
+template<typename T>
+struct is_vector : std::false_type {};
+
+template<typename T>
+struct is_vector<std::vector<T>> : std::true_type {};
+
+template<typename T>
+struct is_map : std::false_type {};
+
+template<typename K, typename V>
+struct is_map<std::map<K, V>> : std::true_type {};
+
+// clang-format off
+template<typename A> void serialize(A& a, tn::Node& node);
+template<typename A> void serialize(A& a, tn::Scene& scene);
+template<typename A> void serialize(A& a, tn::Primitive& primitive);
+template<typename A> void serialize(A& a, tn::Mesh& mesh);
+template<typename A> void serialize(A& a, tn::Accessor& accessor);
+template<typename A> void serialize(A& a, tn::BufferView& bufferView);
+template<typename A> void serialize(A& a, tn::Buffer& buffer);
+template<typename A> void serialize(A& a, tn::TextureInfo& textureInfo);
+template<typename A> void serialize(A& a, tn::NormalTextureInfo& textureInfo);
+template<typename A> void serialize(A& a, tn::OcclusionTextureInfo& textureInfo);
+template<typename A> void serialize(A& a, tn::Material& material);
+template<typename A> void serialize(A& a, tn::Texture& texture);
+template<typename A> void serialize(A& a, tn::Sampler& sampler);
+template<typename A> void serialize(A& a, tn::Image& image);
+template<typename A> void serialize(A& a, tn::Camera& camera);
+template<typename A> void serialize(A& a, tn::Skin& skin);
+template<typename A> void serialize(A& a, animation_clip_t& clip);
+template<typename A> void serialize(A& a, gpu_instancing_t& instancing);
+template<typename A> void serialize(A& a, vertex_streams_t& streams);
+template<typename A> void serialize(A& a, lod_level_t& level);
+// clang-format on
+
+template<typename A, typename T>
+void field(A& a, T& value) {
+  if constexpr(std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+    a.raw(&value, sizeof(T));
+  } else if constexpr(std::same_as<T, std::string>) {
+    const std::size_t n = a.count(std::size(value));
+    if constexpr(A::reading)
+      value.resize(n);
+    a.raw(std::data(value), n);
+  } else if constexpr(is_vector<T>::value) {
+    using element_t = typename T::value_type;
+
+    const std::size_t n = a.count(std::size(value));
+    if constexpr(A::reading)
+      value.resize(n);
+
+    if constexpr(std::is_trivially_copyable_v<element_t>)
+      a.raw(std::data(value), n * sizeof(element_t));
+    else
+      for(element_t& e : value)
+        field(a, e);
+  } else if constexpr(is_map<T>::value) {
+    if constexpr(A::reading) {
+      const std::size_t n = a.count(0);
+      for(std::size_t i = 0; i < n && a.ok; ++i) {
+        typename T::key_type k;
+        typename T::mapped_type v;
+        field(a, k);
+        field(a, v);
+        value.emplace(std::move(k), std::move(v));
+      }
+    } else {
+      a.count(std::size(value));
+      for(auto& [k, v] : value) {
+        field(a, const_cast<typename T::key_type&>(k));
+        field(a, v);
+      }
+    }
+  } else {
+    serialize(a, value);
+  }
+}
+
+template<typename A, typename... T>
+void fields(A& a, T&... values) {
+  (field(a, values), ...);
+}
+
+template<typename A>
+void serialize(A& a, tn::Node& node) {
+  fields(a, node.name, node.mesh, node.camera, node.skin, node.children, node.matrix, node.translation, node.rotation, node.scale, node.weights);
+}
+
+template<typename A>
+void serialize(A& a, tn::Scene& scene) {
+  fields(a, scene.name, scene.nodes);
+}
+
+template<typename A>
+void serialize(A& a, tn::Primitive& primitive) {
+  fields(a, primitive.attributes, primitive.material, primitive.indices, primitive.mode, primitive.targets);
+}
+
+template<typename A>
+void serialize(A& a, tn::Mesh& mesh) {
+  fields(a, mesh.name, mesh.primitives, mesh.weights);
+}
+
+template<typename A>
+void serialize(A& a, tn::Accessor& accessor) {
+  fields(a, accessor.name, accessor.bufferView, accessor.byteOffset, accessor.normalized, accessor.componentType, accessor.count, accessor.type, accessor.minValues,
+         accessor.maxValues);
+
+  tn::Accessor::Sparse& sparse = accessor.sparse;
+  fields(a, sparse.isSparse, sparse.count, sparse.indices.bufferView, sparse.indices.byteOffset, sparse.indices.componentType, sparse.values.bufferView,
+         sparse.values.byteOffset);
+}
+
+template<typename A>
+void serialize(A& a, tn::BufferView& bufferView) {
+  fields(a, bufferView.name, bufferView.buffer, bufferView.byteOffset, bufferView.byteLength, bufferView.byteStride, bufferView.target);
+}
+
+template<typename A>
+void serialize(A& a, tn::Buffer& buffer) {
+  fields(a, buffer.name, buffer.uri); // bytes are blobs
+}
+
+template<typename A>
+void serialize(A& a, tn::TextureInfo& textureInfo) {
+  fields(a, textureInfo.index, textureInfo.texCoord);
+}
+
+template<typename A>
+void serialize(A& a, tn::NormalTextureInfo& textureInfo) {
+  fields(a, textureInfo.index, textureInfo.texCoord, textureInfo.scale);
+}
+
+template<typename A>
+void serialize(A& a, tn::OcclusionTextureInfo& textureInfo) {
+  fields(a, textureInfo.index, textureInfo.texCoord, textureInfo.strength);
+}
+
+template<typename A>
+void serialize(A& a, tn::Material& material) {
+  tn::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+
+  fields(a, material.name, material.emissiveFactor, material.alphaMode, material.alphaCutoff, material.doubleSided, material.normalTexture, material.occlusionTexture,
+         material.emissiveTexture);
+  fields(a, pbr.baseColorFactor, pbr.baseColorTexture, pbr.metallicFactor, pbr.roughnessFactor, pbr.metallicRoughnessTexture);
+}
+
+template<typename A>
+void serialize(A& a, tn::Texture& texture) {
+  fields(a, texture.name, texture.sampler, texture.source);
+}
+
+template<typename A>
+void serialize(A& a, tn::Sampler& sampler) {
+  fields(a, sampler.name, sampler.minFilter, sampler.magFilter, sampler.wrapS, sampler.wrapT);
+}
+
+template<typename A>
+void serialize(A& a, tn::Image& image) {
+  fields(a, image.name, image.width, image.height, image.component, image.bits, image.pixel_type, image.bufferView, image.mimeType, image.uri); // pixels are blobs
+}
+
+template<typename A>
+void serialize(A& a, tn::Camera& camera) {
+  fields(a, camera.name, camera.type);
+  fields(a, camera.perspective.aspectRatio, camera.perspective.yfov, camera.perspective.zfar, camera.perspective.znear);
+  fields(a, camera.orthographic.xmag, camera.orthographic.ymag, camera.orthographic.zfar, camera.orthographic.znear);
+}
+
+template<typename A>
+void serialize(A& a, tn::Skin& skin) {
+  fields(a, skin.name, skin.inverseBindMatrices, skin.skeleton, skin.joints);
+}
+
+template<typename A>
+void serialize(A& a, animation_clip_t& clip) {
+  fields(a, clip.name, clip.duration, clip.timestamps, clip.values, clip.samplers, clip.channels);
+}
+
+template<typename A>
+void serialize(A& a, gpu_instancing_t& instancing) {
+  fields(a, instancing.translation, instancing.rotation, instancing.scale);
+}
+
+template<typename A>
+void serialize(A& a, vertex_streams_t& streams) {
+  fields(a, streams.positions, streams.normals, streams.tangents, streams.texcoords, streams.indices);
+}
+
+template<typename A>
+void serialize(A& a, lod_level_t& level) {
+  fields(a, level.indices, level.error);
+}
+
+template<typename A>
+void serializeModel(A& a, tn::Model& model) {
+  fields(a, model.defaultScene, model.scenes, model.nodes, model.meshes, model.accessors, model.bufferViews, model.buffers, model.materials, model.textures, model.samplers,
+         model.images, model.cameras, model.skins);
+}
+
+struct dependency_t {
+  std::string uri;
+  std::uint64_t hash;
+};
+
+template<typename A>
+void serialize(A& a, dependency_t& dependency) {
+  fields(a, dependency.uri, dependency.hash);
+}
+
+std::uint64_t hashFile(const std::filesystem::path& file) {
+  const util::MappedFile mapped(file);
+  return mapped.isMapped() ? hashBytes(mapped.bytes()) : 0;
+}
+
+// external buffers and images of a .gltf, data URIs are part of the source already
+std::vector<dependency_t> dependencies(const tn::Model& model, const std::filesystem::path& baseDir) {
+  std::vector<dependency_t> files;
+
+  const auto add = [&](const std::string& uri) {
+    if(!std::empty(uri) && !uri.starts_with("data:"))
+      files.push_back({uri, hashFile(baseDir / uri)});
+  };
+
+  for(const tn::Buffer& buffer : model.buffers)
+    add(buffer.uri);
+
+  for(const tn::Image& image : model.images)
+    add(image.uri);
+
+  return files;
+}
+
+}
+
+std::filesystem::path sceneCachePath(const std::filesystem::path& modelglTFFile) {
+  std::filesystem::path cacheFile = modelglTFFile;
+  cacheFile += ".scenecache";
+  return cacheFile;
+}
+
+bool readSceneCache(const std::filesystem::path& cacheFile, std::uint64_t sourceHash, const std::filesystem::path& baseDir, tn::Model& model,
+                    std::vector<animation_clip_t>& animations, std::vector<gpu_instancing_t>& instancing, std::vector<std::vector<vertex_streams_t>>& streams,
+                    std::vector<std::vector<lod_chain_t>>& lods, scene_cache_t& cache) {
+  if(!std::filesystem::exists(cacheFile))
+    return false;
+
+  cache.file = util::MappedFile(cacheFile);
+  if(!cache.file.isMapped())
+    return false;
+
+  reader_t r{cache.file.bytes()};
+
+  std::uint32_t magic = 0, version = 0;
+  std::uint64_t hash = 0;
+  fields(r, magic, version, hash);
+
+  if(!r.ok || magic != cacheMagic || version != cacheVersion || hash != sourceHash) {
+    cache = {};
+    return false;
+  }
+
+  std::vector<dependency_t> files;
+  field(r, files);
+
+  for(const dependency_t& file : files) {
+    if(hashFile(baseDir / file.uri) != file.hash) {
+      cache = {};
+      return false;
+    }
+  }
+
+  model = {};
+  serializeModel(r, model);
+  field(r, animations);
+  field(r, instancing);
+  field(r, streams);
+  field(r, lods);
+
+  cache.buffers.resize(r.count(0));
+  for(std::span<const unsigned char>& bytes : cache.buffers)
+    r.blob(bytes);
+
+  cache.images.resize(r.count(0));
+  for(std::span<const unsigned char>& pixels : cache.images)
+    r.blob(pixels);
+
+  const auto perPrimitive = [&](const auto& meshes) { // [mesh][primitive]
+    return std::size(meshes) == std::size(model.meshes) &&
+           std::ranges::equal(meshes, model.meshes, [](const auto& primitives, const tn::Mesh& mesh) { return std::size(primitives) == std::size(mesh.primitives); });
+  };
+
+  if(!r.ok || std::size(cache.buffers) != std::size(model.buffers) || std::size(cache.images) != std::size(model.images) ||
+     std::size(instancing) != std::size(model.nodes) || !perPrimitive(streams) || !perPrimitive(lods)) {
+    std::println("Error [SceneCache] {} is truncated", cacheFile.string());
+
+    model = {};
+    animations.clear();
+    instancing.clear();
+    streams.clear();
+    lods.clear();
+    cache = {};
+    return false;
+  }
+
+  return true;
+}
+
+bool writeSceneCache(const std::filesystem::path& cacheFile, std::uint64_t sourceHash, const std::filesystem::path& baseDir, const tn::Model& model, buffer_data_t buffers,
+                     buffer_data_t images, std::span<const animation_clip_t> animations, std::span<const gpu_instancing_t> instancing,
+                     const std::vector<std::vector<vertex_streams_t>>& streams, const std::vector<std::vector<lod_chain_t>>& lods) {
+  std::filesystem::path partialFile = cacheFile;
+  partialFile += ".partial";
+
+  writer_t w{std::ofstream(partialFile, std::ios::binary | std::ios::trunc)};
+  if(!w.out) {
+    std::println("Error [SceneCache] can't write {}", partialFile.string());
+    return false;
+  }
+
+  std::uint32_t magic = cacheMagic, version = cacheVersion;
+  std::uint64_t hash = sourceHash;
+  fields(w, magic, version, hash);
+
+  std::vector<dependency_t> files = dependencies(model, baseDir);
+  field(w, files);
+
+  // the writer only reads through these
+  serializeModel(w, const_cast<tn::Model&>(model));
+
+  w.count(std::size(animations));
+  for(animation_clip_t& clip : std::span(const_cast<animation_clip_t*>(std::data(animations)), std::size(animations)))
+    serialize(w, clip);
+
+  w.count(std::size(instancing));
+  for(gpu_instancing_t& node : std::span(const_cast<gpu_instancing_t*>(std::data(instancing)), std::size(instancing)))
+    serialize(w, node);
+
+  field(w, const_cast<std::vector<std::vector<vertex_streams_t>>&>(streams));
+  field(w, const_cast<std::vector<std::vector<lod_chain_t>>&>(lods));
+
+  w.count(std::size(buffers));
+  for(std::span<const unsigned char> bytes : buffers)
+    w.blob(bytes);
+
+  w.count(std::size(images));
+  for(std::span<const unsigned char> pixels : images)
+    w.blob(pixels);
+
+  w.out.close();
+  if(!w.out) {
+    std::println("Error [SceneCache] can't write {}", partialFile.string());
+    std::filesystem::remove(partialFile);
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::rename(partialFile, cacheFile, error); // readers never see a half written cache
+  return !error;
+}
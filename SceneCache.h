@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "Accessor.h"
+#include "Animation.h"
+#include "GeometryArena.h"
+#include "Hash.h"
+#include "LevelOfDetail.h"
+#include "MappedFile.h"
+#include "Node.h"
+
+// Baked scene: the parsed glTF model, buffer bytes, decoded texels, compiled animations, node instancing, optimized vertex streams and LOD chains of a source file,
+// written next to it.
+// Blobs are 16 byte aligned so they're used straight from the mapping.
+struct scene_cache_t {
+  util::MappedFile file;
+
+  std::vector<std::span<const unsigned char>> buffers; // per glTF buffer, into file
+  std::vector<std::span<const unsigned char>> images;  // decoded pixels per glTF image, into file
+};
+
+std::filesystem::path sceneCachePath(const std::filesystem::path& modelglTFFile);
+
+// False when there's no cache, it was written by another version or the source or one of its external files changed
+bool readSceneCache(const std::filesystem::path& cacheFile, std::uint64_t sourceHash, const std::filesystem::path& baseDir, tn::Model& model,
+                    std::vector<animation_clip_t>& animations, std::vector<gpu_instancing_t>& instancing, std::vector<std::vector<vertex_streams_t>>& streams,
+                    std::vector<std::vector<lod_chain_t>>& lods, scene_cache_t& cache);
+
+bool writeSceneCache(const std::filesystem::path& cacheFile, std::uint64_t sourceHash, const std::filesystem::path& baseDir, const tn::Model& model, buffer_data_t buffers,
+                     buffer_data_t images, std::span<const animation_clip_t> animations, std::span<const gpu_instancing_t> instancing,
+                     const std::vector<std::vector<vertex_streams_t>>& streams, const std::vector<std::vector<lod_chain_t>>& lods);
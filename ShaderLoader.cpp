@@ -2,23 +2,72 @@
 
 #include <GL/glew.h>
 
-#include <range/v3/range/conversion.hpp>
-#include <range/v3/view/istream.hpp>
 #include <mpark/patterns/match.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <format>
 #include <fstream>
 #include <filesystem>
+#include <iterator>
+#include <print>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "Hash.h"
+
 namespace util {
 
-ShaderLoader& ShaderLoader::load(const std::vector<std::filesystem::path>& shaderFiles) {
+ShaderLoader& ShaderLoader::setCacheDirectory(const std::filesystem::path& directory, std::size_t maxPrograms) {
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+
+  if(error)
+    std::println("Error [ShaderLoader] can't create {}: {}", directory.string(), error.message());
+  else
+    cacheDirectory = directory;
+
+  maxCachedPrograms = maxPrograms;
+
+  return *this;
+}
+
+ShaderLoader& ShaderLoader::load(const std::vector<std::filesystem::path>& shaderFiles, const std::vector<std::string>& defines) {
+  std::vector<std::pair<GLenum, std::string>> sources;
+
   for(const auto& shaderFile : shaderFiles) {
     std::string shaderSource = this->getShaderFileSource(shaderFile);
-    auto data = std::data(shaderSource);
 
-    GLenum type = this->identifyShaderType(shaderFile);
+    if(!std::empty(defines)) { // right after #version, which has to stay the first line
+      std::string defineLines;
+      for(const std::string& define : defines)
+        defineLines += std::format("#define {}\n", define);
+
+      const std::size_t versionEnd = shaderSource.starts_with("#version") ? shaderSource.find('\n') + 1 : 0;
+      shaderSource.insert(versionEnd, defineLines);
+    }
+
+    sources.emplace_back(this->identifyShaderType(shaderFile), std::move(shaderSource));
+  }
+
+  // a binary is only valid for the driver that produced it
+  cacheKey = 0xCBF29CE484222325;
+  for(GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    cacheKey = hashString(reinterpret_cast<const char*>(glGetString(name)), cacheKey);
+
+  for(const auto& [type, source] : sources) {
+    cacheKey = hashBytes({reinterpret_cast<const unsigned char*>(&type), sizeof(type)}, cacheKey);
+    cacheKey = hashString(source, cacheKey);
+  }
+
+  loadedFromCache = !cacheDirectory.empty() && loadProgramBinary();
+  if(loadedFromCache)
+    return *this;
+
+  for(const auto& [type, source] : sources) {
+    auto data = std::data(source);
 
     GLuint shaderID = glCreateShader(type);
     glShaderSource(shaderID, 1, &data, nullptr);
@@ -36,7 +85,11 @@ ShaderLoader& ShaderLoader::compile() {
 }
 
 ShaderLoader& ShaderLoader::attach() {
+  if(loadedFromCache)
+    return *this;
+
   programID = glCreateProgram();
+  glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
   for(GLuint shaderID : shaderIDs)
     glAttachShader(programID, shaderID);
@@ -45,10 +98,18 @@ ShaderLoader& ShaderLoader::attach() {
 }
 
 ShaderLoader& ShaderLoader::link() {
-  glLinkProgram(programID);
+  if(!loadedFromCache) {
+    glLinkProgram(programID);
 
-  for(GLuint shaderID : shaderIDs)
-    glDetachShader(programID, shaderID);
+    for(GLuint shaderID : shaderIDs)
+      glDetachShader(programID, shaderID);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+
+    if(linked && !cacheDirectory.empty() && emitProgramBinary(cacheFile()))
+      pruneCache();
+  }
 
   glUseProgram(programID);
 
@@ -58,24 +119,81 @@ ShaderLoader& ShaderLoader::link() {
 void ShaderLoader::unload() {
   for(GLuint shaderID : shaderIDs)
     glDeleteShader(shaderID);
+  shaderIDs.clear();
 
   glDeleteProgram(programID);
 }
 
-void ShaderLoader::emitProgramBinary() const {
+// binary file layout: GLenum binaryFormat, then the program binary
+bool ShaderLoader::emitProgramBinary(const std::filesystem::path& binaryFile) const {
   if(!glIsProgram(programID))
-    return;
+    return false;
 
-  GLint binarySize;
+  GLint binarySize = 0;
   glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+  if(binarySize == 0)
+    return false;
 
   std::vector<char> programBinary(binarySize, '\0');
 
   GLenum binaryFormat = GL_NONE;
   glGetProgramBinary(programID, binarySize, nullptr, &binaryFormat, std::data(programBinary));
 
-  std::ofstream fout{"programBinary.bin", std::ios::binary};
+  std::ofstream fout{binaryFile, std::ios::binary};
+  fout.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
   fout.write(std::data(programBinary), std::size(programBinary));
+
+  return static_cast<bool>(fout);
+}
+
+std::filesystem::path ShaderLoader::cacheFile() const {
+  return cacheDirectory / std::format("{:016x}.bin", cacheKey);
+}
+
+bool ShaderLoader::loadProgramBinary() {
+  const std::filesystem::path binaryFile = cacheFile();
+
+  std::ifstream fin{binaryFile, std::ios::binary};
+  if(!fin)
+    return false;
+
+  GLenum binaryFormat = GL_NONE;
+  fin.read(reinterpret_cast<char*>(&binaryFormat), sizeof(binaryFormat));
+
+  const std::vector<char> programBinary{std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>()};
+
+  programID = glCreateProgram();
+  glProgramBinary(programID, binaryFormat, std::data(programBinary), std::size(programBinary));
+
+  GLint linked = GL_FALSE;
+  glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+
+  if(!linked) { // driver update or a format it no longer accepts, compile and overwrite it
+    glGetError(); // an unknown binaryFormat also raises GL_INVALID_ENUM
+    glDeleteProgram(programID);
+    std::filesystem::remove(binaryFile);
+
+    return false;
+  }
+
+  std::filesystem::last_write_time(binaryFile, std::filesystem::file_time_type::clock::now()); // most recently used survive pruning
+
+  return true;
+}
+
+void ShaderLoader::pruneCache() const {
+  std::vector<std::filesystem::directory_entry> binaries;
+  for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(cacheDirectory))
+    if(entry.is_regular_file() && entry.path().extension() == ".bin")
+      binaries.push_back(entry);
+
+  if(std::size(binaries) <= maxCachedPrograms)
+    return;
+
+  std::ranges::sort(binaries, std::ranges::greater{}, [](const std::filesystem::directory_entry& entry) { return entry.last_write_time(); });
+
+  for(std::size_t i = maxCachedPrograms; i < std::size(binaries); ++i)
+    std::filesystem::remove(binaries[i].path());
 }
 
 GLenum ShaderLoader::identifyShaderType(const std::filesystem::path& shaderFile) const {
@@ -93,10 +211,33 @@ GLenum ShaderLoader::identifyShaderType(const std::filesystem::path& shaderFile)
   // clang-format on
 }
 
-std::string ShaderLoader::getShaderFileSource(const std::filesystem::path& shaderFile) const {
+// #include "file" is replaced by the file's source, looked up next to the including file
+std::string ShaderLoader::getShaderFileSource(const std::filesystem::path& shaderFile, int includeDepth) const {
+  constexpr int maxIncludeDepth = 16; // include cycles
+
   std::ifstream fin{shaderFile};
-  fin.unsetf(std::ifstream::skipws);
+  if(!fin)
+    std::println("Error [ShaderLoader] can't open {}", shaderFile.string());
+
+  std::string source;
+  for(std::string line; std::getline(fin, line);) {
+    if(const std::size_t start = line.find_first_not_of(" \t"); start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+      const std::size_t first = line.find('"');
+      const std::size_t last = line.rfind('"');
+
+      if(first == std::string::npos || first == last || includeDepth == maxIncludeDepth) {
+        std::println("Error [ShaderLoader] {}: bad {}", shaderFile.string(), line);
+        continue;
+      }
+
+      source += getShaderFileSource(shaderFile.parent_path() / line.substr(first + 1, last - first - 1), includeDepth + 1);
+      continue;
+    }
+
+    source += line;
+    source += '\n';
+  }
 
-  return ranges::istream<char>(fin) | ranges::to<std::string>;
+  return source;
 }
 }
@@ -2,6 +2,7 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -12,21 +13,38 @@ struct ShaderLoader {
   std::vector<GLuint> shaderIDs;
   GLuint programID;
 
-  ShaderLoader& load(const std::vector<std::filesystem::path>& shaderFiles);
+  // Linked programs are stored as <hash>.bin in directory and reused while the sources, defines and driver stay the same
+  ShaderLoader& setCacheDirectory(const std::filesystem::path& directory, std::size_t maxPrograms = 64);
+
+  ShaderLoader& load(const std::vector<std::filesystem::path>& shaderFiles, const std::vector<std::string>& defines = {});
   ShaderLoader& compile();
   ShaderLoader& attach();
   ShaderLoader& link();
   void unload();
 
-  void emitProgramBinary() const;
+  bool emitProgramBinary(const std::filesystem::path& binaryFile) const;
 
   GLuint getProgramID() const {
     return programID;
   }
 
+  bool isFromCache() const {
+    return loadedFromCache;
+  }
+
 private:
+  std::filesystem::path cacheDirectory;
+  std::size_t maxCachedPrograms = 0;
+
+  std::uint64_t cacheKey = 0;
+  bool loadedFromCache = false;
+
+  std::filesystem::path cacheFile() const;
+  bool loadProgramBinary();
+  void pruneCache() const;
+
   GLenum identifyShaderType(const std::filesystem::path& shaderFile) const;
-  std::string getShaderFileSource(const std::filesystem::path& shaderFile) const;
+  std::string getShaderFileSource(const std::filesystem::path& shaderFile, int includeDepth = 0) const;
 };
 
 }
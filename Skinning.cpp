@@ -0,0 +1,81 @@
+#include "Skinning.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+
+namespace {
+
+// out = a * b, column major. Every column of out is the columns of a weighted by one column of b.
+void multiply(const glm::mat4x4& a, const glm::mat4x4& b, glm::mat4x4& out) {
+  const float* pa = glm::value_ptr(a);
+  const float* pb = glm::value_ptr(b);
+  float* po = glm::value_ptr(out);
+
+#if defined(__AVX__)
+  const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 0)), a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 4));
+  const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 8)), a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 12));
+
+  for(int column = 0; column < 4; column += 2) { // two columns per register
+    const float* c = pb + column * 4;
+    const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a0, _mm256_set_m128(_mm_set1_ps(c[4]), _mm_set1_ps(c[0]))),
+                                                 _mm256_mul_ps(a1, _mm256_set_m128(_mm_set1_ps(c[5]), _mm_set1_ps(c[1])))),
+                                   _mm256_add_ps(_mm256_mul_ps(a2, _mm256_set_m128(_mm_set1_ps(c[6]), _mm_set1_ps(c[2]))),
+                                                 _mm256_mul_ps(a3, _mm256_set_m128(_mm_set1_ps(c[7]), _mm_set1_ps(c[3])))));
+    _mm256_storeu_ps(po + column * 4, r);
+  }
+#elif defined(__SSE__) || defined(_M_X64)
+  const __m128 a0 = _mm_loadu_ps(pa + 0), a1 = _mm_loadu_ps(pa + 4), a2 = _mm_loadu_ps(pa + 8), a3 = _mm_loadu_ps(pa + 12);
+
+  for(int column = 0; column < 4; ++column) {
+    const float* c = pb + column * 4;
+    const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(c[0])), _mm_mul_ps(a1, _mm_set1_ps(c[1]))),
+                                _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(c[2])), _mm_mul_ps(a3, _mm_set1_ps(c[3]))));
+    _mm_storeu_ps(po + column * 4, r);
+  }
+#else
+  out = a * b;
+#endif
+}
+
+}
+
+skin_t joint_palette_t::add(std::span<const int> slots, std::span<const float> inverseBind) {
+  assert(std::empty(inverseBind) || std::size(inverseBind) >= std::size(slots) * 16);
+
+  const skin_t skin{static_cast<std::uint32_t>(size()), static_cast<std::uint32_t>(std::size(slots))};
+
+  for(std::size_t i = 0; i < std::size(slots); ++i) {
+    jointSlots.push_back(slots[i]);
+    inverseBindMatrices.push_back(std::empty(inverseBind) ? glm::mat4x4(1.0f) : glm::make_mat4x4(std::data(inverseBind) + 16 * i));
+  }
+
+  matrices.resize(size(), glm::mat4x4(1.0f));
+
+  return skin;
+}
+
+void joint_palette_t::clear() {
+  jointSlots.clear();
+  inverseBindMatrices.clear();
+  matrices.clear();
+}
+
+void joint_palette_t::update(std::span<const glm::mat4x4> world, std::size_t first, std::size_t count) {
+  assert(first + count <= size());
+
+  for(std::size_t i = first; i < first + count; ++i) {
+    if(const int slot = jointSlots[i]; slot != -1)
+      multiply(world[slot], inverseBindMatrices[i], matrices[i]);
+    else
+      matrices[i] = inverseBindMatrices[i];
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// A glTF skin's joints, a range of the joint palette
+struct skin_t {
+  std::uint32_t firstJoint;
+  std::uint32_t jointCount;
+};
+
+// The joints of every skin side by side, so one pass computes all skinning matrices of a frame.
+// matrices[i] = world[jointSlots[i]] * inverseBindMatrices[i], in world space: the skinned mesh node's own transform doesn't apply.
+struct joint_palette_t {
+  std::vector<int> jointSlots; // hierarchy slot of each joint, -1 for joints outside every scene
+  std::vector<glm::mat4x4> inverseBindMatrices;
+  std::vector<glm::mat4x4> matrices; // std430 mat4 array, as uploaded
+
+  skin_t add(std::span<const int> slots, std::span<const float> inverseBind); // 16 floats per joint, empty for identities
+  void clear();
+
+  void update(std::span<const glm::mat4x4> world, std::size_t first, std::size_t count); // joints [first, first + count)
+
+  std::size_t size() const {
+    return std::size(jointSlots);
+  }
+};
@@ -0,0 +1,43 @@
+#include <GL/glew.h>
+
+#include <cassert>
+
+#include "TextureCache.h"
+
+GLuint TextureCache::acquire(const texture_key_t& key) {
+  const auto it = entries.find(key);
+  if(it == std::end(entries))
+    return 0;
+
+  ++it->second.references;
+  return it->second.textureID;
+}
+
+void TextureCache::insert(const texture_key_t& key, GLuint textureID) {
+  assert(!entries.contains(key));
+
+  entries[key] = {textureID, 1};
+  keys[textureID] = key;
+}
+
+void TextureCache::release(GLuint textureID) {
+  const auto key = keys.find(textureID);
+  assert(key != std::end(keys));
+
+  const auto it = entries.find(key->second);
+  if(--it->second.references != 0)
+    return;
+
+  glDeleteTextures(1, &textureID);
+
+  entries.erase(it);
+  keys.erase(key);
+}
+
+void TextureCache::clear() {
+  for(const auto& [textureID, _] : keys)
+    glDeleteTextures(1, &textureID);
+
+  entries.clear();
+  keys.clear();
+}
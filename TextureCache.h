@@ -0,0 +1,42 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+struct texture_key_t {
+  int image; // glTF image index
+  bool sRGB;
+
+  auto operator<=>(const texture_key_t&) const = default;
+};
+
+// GL textures shared by every material referring to the same image and colour space, sampling state lives in SamplerCache
+struct TextureCache {
+  // Takes a reference on the cached texture, 0 when the key isn't cached yet
+  GLuint acquire(const texture_key_t& key);
+
+  // Caches a texture created for key with one reference
+  void insert(const texture_key_t& key, GLuint textureID);
+
+  // Drops a reference, the texture is deleted with the last one
+  void release(GLuint textureID);
+
+  void clear();
+
+  std::size_t size() const {
+    return std::size(entries);
+  }
+
+private:
+  struct entry_t {
+    GLuint textureID;
+    std::uint32_t references;
+  };
+
+  std::map<texture_key_t, entry_t> entries;
+  std::unordered_map<GLuint, texture_key_t> keys;
+};
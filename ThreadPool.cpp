@@ -0,0 +1,51 @@
+#include "ThreadPool.h"
+
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace util {
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+  workers.reserve(threadCount);
+
+  for(unsigned i = 0; i < threadCount; ++i)
+    workers.emplace_back([this](std::stop_token stop) { work(stop); });
+}
+
+ThreadPool::~ThreadPool() {
+  for(std::jthread& worker : workers)
+    worker.request_stop();
+
+  workers.clear(); // join before the queue and its lock go away
+}
+
+void ThreadPool::submit(std::move_only_function<void()> task) {
+  {
+    std::lock_guard lock(mutex);
+    tasks.push(std::move(task));
+  }
+
+  available.notify_one();
+}
+
+void ThreadPool::work(std::stop_token stop) {
+  while(true) {
+    std::move_only_function<void()> task;
+
+    {
+      std::unique_lock lock(mutex);
+      if(!available.wait(lock, stop, [this] { return !tasks.empty(); }))
+        return;
+
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+
+    task();
+  }
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <queue>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+class ThreadPool {
+public:
+  explicit ThreadPool(unsigned threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void submit(std::move_only_function<void()> task);
+
+  // Splits [0, count) into contiguous chunks, one of them runs on the calling thread. Returns when every chunk is done.
+  template<typename F>
+  void parallelFor(std::size_t count, F&& f) {
+    const std::size_t chunks = std::min(count, std::size(workers) + 1);
+
+    if(chunks <= 1) {
+      for(std::size_t i = 0; i < count; ++i)
+        f(i);
+      return;
+    }
+
+    std::latch done(chunks - 1);
+
+    for(std::size_t c = 1; c < chunks; ++c) {
+      submit([&f, &done, begin = count * c / chunks, end = count * (c + 1) / chunks] {
+        for(std::size_t i = begin; i < end; ++i)
+          f(i);
+        done.count_down();
+      });
+    }
+
+    for(std::size_t i = 0; i < count / chunks; ++i)
+      f(i);
+
+    done.wait();
+  }
+
+  std::size_t size() const {
+    return std::size(workers);
+  }
+
+private:
+  void work(std::stop_token stop);
+
+  std::vector<std::jthread> workers;
+  std::queue<std::move_only_function<void()>> tasks;
+
+  std::mutex mutex;
+  std::condition_variable_any available;
+};
+
+}
@@ -0,0 +1,57 @@
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cassert>
+
+#include "TransformHierarchy.h"
+
+int transform_hierarchy_t::add(int parentSlot) {
+  assert(parentSlot < static_cast<int>(size()));
+
+  parent.push_back(parentSlot);
+
+  translation.push_back(glm::vec3(0.0f));
+  rotation.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  scale.push_back(glm::vec3(1.0f));
+
+  local.push_back(glm::mat4x4(1.0f));
+  world.push_back(glm::mat4x4(1.0f));
+
+  dirty.push_back(worldDirty);
+  changed.push_back(0);
+
+  return static_cast<int>(size()) - 1;
+}
+
+void transform_hierarchy_t::clear() {
+  parent.clear();
+  translation.clear();
+  rotation.clear();
+  scale.clear();
+  local.clear();
+  world.clear();
+  dirty.clear();
+  changed.clear();
+}
+
+void transform_hierarchy_t::setLocal(int slot, const glm::mat4x4& matrix) {
+  local[slot] = matrix;
+  dirty[slot] = (dirty[slot] & ~localDirty) | worldDirty;
+}
+
+void transform_hierarchy_t::update() {
+  for(std::size_t i = 0; i < size(); ++i) {
+    const int p = parent[i];
+    const std::uint8_t flags = dirty[i];
+
+    if(flags & localDirty)
+      local[i] = glm::translate(glm::mat4x4(1.0f), translation[i]) * glm::mat4_cast(rotation[i]) * glm::scale(glm::mat4x4(1.0f), scale[i]);
+
+    const bool update = flags != 0 || (p != -1 && changed[p] != 0);
+    if(update)
+      world[i] = p == -1 ? local[i] : world[p] * local[i];
+
+    changed[i] = update;
+    dirty[i] = 0;
+  }
+}
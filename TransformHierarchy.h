@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scene graph transforms in structure of arrays form. Slots are ordered parent before child (pre-order),
+// so a single front to back pass sees every parent's world matrix before its children need it.
+struct transform_hierarchy_t {
+  enum dirty_t : std::uint8_t {
+    localDirty = 1 << 0, // translation, rotation or scale changed
+    worldDirty = 1 << 1, // world matrix needs to be recomputed
+  };
+
+  std::vector<int> parent; // -1 for roots
+
+  std::vector<glm::vec3> translation;
+  std::vector<glm::quat> rotation;
+  std::vector<glm::vec3> scale;
+
+  std::vector<glm::mat4x4> local;
+  std::vector<glm::mat4x4> world;
+
+  std::vector<std::uint8_t> dirty;
+  std::vector<std::uint8_t> changed; // world matrix was recomputed by the last update()
+
+  int add(int parentSlot);
+  void clear();
+
+  void setLocal(int slot, const glm::mat4x4& matrix);
+  void markDirty(int slot) {
+    dirty[slot] |= localDirty;
+  }
+
+  void update();
+
+  std::size_t size() const {
+    return std::size(parent);
+  }
+};
@@ -1,90 +1,57 @@
 #version 460 core
 #extension all: warn
 
+#ifdef SHADER_DEBUG
 #pragma optimize(off)
 #pragma debug(on)
+#else
+#pragma optimize(on)
+#endif
 
-struct PBRMetallicRoughness_t {
-  vec4 baseColor;
-  float metallic;
-  float roughness;
-};
-uniform PBRMetallicRoughness_t pbr;
-
-uniform vec3 emissiveFactor;
-
-struct BaseColorTexture_t {
-  bool isDefined;
-  sampler2D sampler;
-};
-uniform BaseColorTexture_t baseColorTexture;
-
-struct MetallicRoughnessTexture_t {
-  bool isDefined;
-  sampler2D sampler;
-};
-uniform MetallicRoughnessTexture_t metallicRoughnessTexture;
-
-struct NormalTexture_t {
-  bool isDefined;
-  sampler2D sampler;
-  float scale;
-};
-uniform NormalTexture_t normalTexture;
-
-struct OcclusionTexture_t {
-  bool isDefined;
-  sampler2D sampler;
-  float strength;
-};
-uniform OcclusionTexture_t occlusionTexture;
-
-struct EmissiveTexture_t {
-  bool isDefined;
-  sampler2D sampler;
-};
-uniform EmissiveTexture_t emissiveTexture;
+#include "material.glsl"
 
 in vec3 normal;
 in vec4 tangent;
 in vec2 textureCoordinate;
+flat in uint materialIndex;
 
 out vec4 fragmentColor;
 
 void main() {
-  vec4 baseColorFinal = pbr.baseColor;
-  if(baseColorTexture.isDefined) {
-    baseColorFinal *= texture(baseColorTexture.sampler, textureCoordinate);
-  }
+  Material_t material = materials[materialIndex];
 
-  float roughnessFinal = pbr.roughness;
-  float metallicFinal = pbr.metallic;
-  if(metallicRoughnessTexture.isDefined) {
-    vec4 sampled = texture(metallicRoughnessTexture.sampler, textureCoordinate);
-    roughnessFinal = pbr.roughness * sampled.g;
-    metallicFinal = pbr.metallic * sampled.b;
-  }
+  vec4 baseColorFinal = material.baseColorFactor;
+#ifdef HAS_BASE_COLOR_TEXTURE
+  baseColorFinal *= texture(baseColorTexture, textureCoordinate);
+#endif
+
+  float roughnessFinal = material.roughnessFactor;
+  float metallicFinal = material.metallicFactor;
+#ifdef HAS_METALLIC_ROUGHNESS_TEXTURE
+  vec4 metallicRoughness = texture(metallicRoughnessTexture, textureCoordinate);
+  roughnessFinal = material.roughnessFactor * metallicRoughness.g;
+  metallicFinal = material.metallicFactor * metallicRoughness.b;
+#endif
 
   vec3 N = normalize(normal);
-  if(normalTexture.isDefined) {
-    vec3 n = texture(normalTexture.sampler, textureCoordinate).rgb;
-    n = n * 2.0f - 1.0f;
-    n *= normalTexture.scale;
-    n = normalize(n);
-  }
+#ifdef HAS_NORMAL_TEXTURE
+  vec3 n = texture(normalTexture, textureCoordinate).rgb;
+  n = n * 2.0f - 1.0f;
+  n *= material.normalScale;
+  n = normalize(n);
+#endif
 
   float occlusionValueFinal = 1.0f;
-  if(occlusionTexture.isDefined) {
-    float sampled = texture(occlusionTexture.sampler, textureCoordinate).r;
-    occlusionValueFinal = 1.0f + occlusionTexture.strength * (sampled - 1.0f);
-    occlusionValueFinal = clamp(occlusionValueFinal, 0.0f, 1.0f);
-  }
-
-  vec3 emissiveValueFinal = emissiveFactor;
-  if(emissiveTexture.isDefined) {
-    vec3 sampled = texture(emissiveTexture.sampler, textureCoordinate).rgb;
-    emissiveValueFinal *= sampled;
-  }
+#ifdef HAS_OCCLUSION_TEXTURE
+  float occlusion = texture(occlusionTexture, textureCoordinate).r;
+  occlusionValueFinal = 1.0f + material.occlusionStrength * (occlusion - 1.0f);
+  occlusionValueFinal = clamp(occlusionValueFinal, 0.0f, 1.0f);
+#endif
+
+  vec3 emissiveValueFinal = material.emissiveFactor;
+#ifdef HAS_EMISSIVE_TEXTURE
+  emissiveValueFinal *= texture(emissiveTexture, textureCoordinate).rgb;
+#endif
 
   vec3 base = baseColorFinal.rgb;
   vec3 F0 = mix(vec3(0.04f), base, metallicFinal);
@@ -0,0 +1,31 @@
+// std430 layout of gpu_material_t in Material.h
+struct Material_t {
+  vec4 baseColorFactor;
+  vec3 emissiveFactor;
+  float roughnessFactor;
+  float metallicFactor;
+  float normalScale;
+  float occlusionStrength;
+  uint textureFlags;
+};
+
+layout(std430, binding = 1) readonly buffer Materials {
+  Material_t materials[];
+};
+
+// texture units are material_t::textureKind, each sampler only exists in the program variants that read it
+#ifdef HAS_BASE_COLOR_TEXTURE
+layout(binding = 0) uniform sampler2D baseColorTexture;
+#endif
+#ifdef HAS_METALLIC_ROUGHNESS_TEXTURE
+layout(binding = 1) uniform sampler2D metallicRoughnessTexture;
+#endif
+#ifdef HAS_NORMAL_TEXTURE
+layout(binding = 2) uniform sampler2D normalTexture;
+#endif
+#ifdef HAS_OCCLUSION_TEXTURE
+layout(binding = 3) uniform sampler2D occlusionTexture;
+#endif
+#ifdef HAS_EMISSIVE_TEXTURE
+layout(binding = 4) uniform sampler2D emissiveTexture;
+#endif
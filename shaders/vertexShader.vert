@@ -1,28 +1,128 @@
 #version 460 core
 #extension all: warn
 
+#ifdef SHADER_DEBUG
 #pragma optimize(off)
 #pragma debug(on)
+#else
+#pragma optimize(on)
+#endif
 
-in vec3 vertexPosition;
-in vec3 vertexNormal;
-in vec4 vertexTangent;
+// vertexAttribute_t in GeometryArena.h, quantizedStreams formats in the comments
+layout(location = 0) in vec3 vertexPosition; // unorm16 in the mesh bounds, the draw transform maps them back
+layout(location = 1) in vec3 vertexNormal;   // octahedral snorm16 xy
+layout(location = 2) in vec4 vertexTangent;  // octahedral snorm16 xy, bitangent sign in w
 
-in vec2 TEXCOORD_0;
+layout(location = 3) in vec2 TEXCOORD_0; // half float
 
-uniform mat4x4 transform;
-uniform mat4x4 view;
-uniform mat4x4 projection;
+layout(location = 8) in uvec4 JOINTS_0;
+layout(location = 9) in vec4 WEIGHTS_0;
+
+// vertexStream_t in GeometryArena.h
+const uint positionStream = 1u << 0;
+const uint normalStream = 1u << 1;
+const uint tangentStream = 1u << 2;
+const uint quantizedStreams = 1u << 4;
+
+struct DrawData_t {
+  mat4x4 transform;
+  uint materialIndex;
+  uint vertexFormat;
+  uint firstJoint;
+
+  uint firstMorphWeight;
+  uint morphWeightCount;
+  uint firstMorphDelta;
+  uint morphVertexCount;
+  uint morphAttributes;
+};
+
+const uint noSkin = 0xFFFFFFFFu;
+
+layout(std430, binding = 0) readonly buffer DrawData {
+  DrawData_t drawData[];
+};
+
+// world * inverse bind matrix of every joint of every skin, Scene::jointPalette
+layout(std430, binding = 2) readonly buffer JointPalette {
+  mat4x4 joints[];
+};
+
+// morph_targets_t in Node.h: per target the present attributes of POSITION, NORMAL, TANGENT, each vertex count long
+layout(std430, binding = 3) readonly buffer MorphDeltas {
+  vec4 morphDeltas[];
+};
+
+struct MorphWeight_t {
+  uint target;
+  float weight;
+};
+
+// the non-zero weights of each node, Scene::activeMorphWeights
+layout(std430, binding = 4) readonly buffer MorphWeights {
+  MorphWeight_t morphWeights[];
+};
+
+// explicit so every program variant shares them
+layout(location = 0) uniform mat4x4 view;
+layout(location = 1) uniform mat4x4 projection;
 
 out vec3 normal;
 out vec4 tangent;
 out vec2 textureCoordinate;
+flat out uint materialIndex;
+
+vec3 octahedralDecode(vec2 e) {
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-v.z, 0.0); // unfold the lower half
+  v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+  return normalize(v);
+}
 
 void main() {
-  normal = vertexNormal;
-  tangent = vertexTangent;
+  DrawData_t draw = drawData[gl_BaseInstance + gl_InstanceID]; // an instance of a draw group, multi draws set baseInstance per command
+  materialIndex = draw.materialIndex;
+
+  if((draw.vertexFormat & quantizedStreams) != 0u) {
+    normal = octahedralDecode(vertexNormal.xy);
+    tangent = vec4(octahedralDecode(vertexTangent.xy), vertexTangent.w);
+  } else {
+    normal = vertexNormal;
+    tangent = vertexTangent;
+  }
   textureCoordinate = TEXCOORD_0;
 
-  gl_Position = projection * view * transform * vec4(vertexPosition, 1.0);
+  vec3 position = vertexPosition;
+  if(draw.morphWeightCount != 0u) { // gl_VertexID is the exported vertex, morphed primitives are never reordered or merged
+    const uint attributeCount = uint(bitCount(draw.morphAttributes));
+
+    for(uint i = 0u; i < draw.morphWeightCount; ++i) {
+      const MorphWeight_t morph = morphWeights[draw.firstMorphWeight + i];
+      uint delta = draw.firstMorphDelta + morph.target * attributeCount * draw.morphVertexCount + uint(gl_VertexID);
+
+      if((draw.morphAttributes & positionStream) != 0u) {
+        position += morph.weight * morphDeltas[delta].xyz;
+        delta += draw.morphVertexCount;
+      }
+      if((draw.morphAttributes & normalStream) != 0u) {
+        normal += morph.weight * morphDeltas[delta].xyz;
+        delta += draw.morphVertexCount;
+      }
+      if((draw.morphAttributes & tangentStream) != 0u)
+        tangent.xyz += morph.weight * morphDeltas[delta].xyz;
+    }
+  }
+
+  mat4x4 model = draw.transform;
+  if(draw.firstJoint != noSkin) { // the joints are in world space, the node's transform doesn't apply
+    model = WEIGHTS_0.x * joints[draw.firstJoint + JOINTS_0.x] + WEIGHTS_0.y * joints[draw.firstJoint + JOINTS_0.y] +
+            WEIGHTS_0.z * joints[draw.firstJoint + JOINTS_0.z] + WEIGHTS_0.w * joints[draw.firstJoint + JOINTS_0.w];
+
+    const mat3 skin = mat3(model);
+    normal = skin * normal; // normalized by the fragment shader
+    tangent.xyz = skin * tangent.xyz;
+  }
+
+  gl_Position = projection * view * model * vec4(position, 1.0);
 }
 